@@ -18,8 +18,26 @@
 /*  Include files             */
 /******************************/
 
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L   /* POSIX (pipes, poll) in strict C  */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SHARDS
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 /******************************/
 /*  External definitions      */
@@ -32,6 +50,7 @@
 #define BOARD        33
 #define PINS         32
 #define SL           PINS
+#define MOVES        76
 
 /* stuff based on 12 Mb RAM and 8 byte STATEs */
 #define PINS_LEFT    21
@@ -45,6 +64,42 @@
 
 #define HASH_SIZ     PRIME_1
 #define HASH_HIST    22
+
+/* hash table modes: exact or a lossy cache of buckets (CACHE_WAYS    */
+/* entries, in two-tier mode CACHE_TIER of them depth-preferred)      */
+#define CACHE_EXACT     0
+#define CACHE_DEPTH     1
+#define CACHE_ALWAYS    2
+#define CACHE_TWO_TIER  3
+#define CACHE_COUNT     4
+#define CACHE_WAYS      4
+#define CACHE_TIER      2
+
+/* phase 2 strategies to find the meeting point of both frontiers */
+#define JOIN_PROBE   0
+#define JOIN_MERGE   1
+
+/* move ordering policies used during the phase 2 traversal */
+#define ORDER_BITS      0
+#define ORDER_CENTER    1
+#define ORDER_ISOLATED  2
+#define ORDER_HISTORY   3
+#define ORDER_PAGODA    4
+#define ORDER_COUNT     5
+
+/* sharded search (see 'shard_solve') */
+#define SHARD_MAX       16
+#ifdef SHARDS
+#define SHARD_BATCH     ((int)(PIPE_BUF / sizeof(KEY)))
+#endif
+
+/* sorted levels of KEYs (id and slack) used by the JOIN_MERGE join */
+#define KEY_BITS     (PINS + 1)
+#define KEY_RADIX    11
+#define LEVEL_MEET   ((BOARD + 1) / 2)
+
+/* symmetries of the board: 4 rotations, each with or without mirror */
+#define SYMMETRIES   8
  
 /******************************/
 /*  Type definitions          */
@@ -57,25 +112,40 @@ typedef struct state
 } STATE;
 
 typedef struct update
-{ int             allowed;
-  int             rank;
-  unsigned int    next_id;
+{ unsigned int    next_id;
   unsigned int    mask_id;
   unsigned short  next_slack;
   unsigned short  mask_slack;
+  unsigned char   pinh;
+  unsigned char   next;
+  unsigned char   nxt2;
 } UPDATE;
 
+typedef unsigned long long  KEY;
+typedef long long           COUNT;
+
+typedef struct solution_iter
+{ int             pins;
+  int             next[BOARD];
+  int             move[BOARD];
+  int             sym[BOARD];
+  STATE           state[BOARD];
+} SOLUTION_ITER;
+
 /******************************/
 /*  Forward definitions       */
 /******************************/
 
 static int  solve(STATE *state_p, int phase);
+static KEY  state_key(STATE *actual_p);
+#ifdef SHARDS
+static int  shard_probe(KEY key);
+#endif
 
 /******************************/
 /*  Global data declarations  */
 /******************************/
 
-static UPDATE  table[BOARD * 4];
 static int     move[BOARD];
 static STATE   move_state[BOARD];
 static STATE   solution_move_state[BOARD];
@@ -92,6 +162,63 @@ static int     hash_match[HASH_HIST];
 static int     hash_match_overflow;
 static int     hash_percent;
 static int     hash_check_point;
+static int     hash_size;
+
+static int     cache_option  = CACHE_EXACT;
+static int     cache_entries = HASH_SIZ / CACHE_WAYS * CACHE_WAYS;
+static int     cache_mode;
+static int     cache_buckets;
+static int     cache_next;
+static COUNT   cache_lookups;
+static COUNT   cache_hits;
+static COUNT   cache_evictions;
+static COUNT   cache_dropped;
+
+static STATE   *frontier;
+static int     frontier_size;
+static int     frontier_bits;
+static int     frontier_count;
+static int     frontier_max = 0;
+static COUNT   frontier_dropped;
+static int     frontier_parts = 1;
+static int     frontier_part[2];
+
+static int     join_mode = JOIN_PROBE;
+static int     order_mode = ORDER_BITS;
+static KEY     order_neighbours[BOARD];
+static COUNT   order_history[MOVES];
+static COUNT   order_nodes;
+static COUNT   order_probes;
+
+static int     shard_count = 0;
+#ifdef SHARDS
+static int     shard_self = -1;
+static int     shard_inbox;
+static int     shard_outbox[SHARD_MAX];
+static int     shard_command;
+static int     shard_report;
+static KEY     *shard_next;
+static int     shard_next_size;
+static int     shard_next_sorted;
+static int     shard_next_max;
+static int     shard_ends;
+static int     shard_to[SHARD_MAX];
+static int     shard_from[SHARD_MAX];
+static pid_t   shard_pid[SHARD_MAX];
+static void    (*shard_sigpipe)(int);
+static KEY     shard_origin[SHARD_MAX][SHARD_BATCH];
+static KEY     shard_start;
+static KEY     shard_hit;
+static KEY     shard_hit_start;
+static int     shard_replay;
+static KEY     shard_out[SHARD_MAX][SHARD_BATCH];
+static int     shard_out_size[SHARD_MAX];
+#endif
+static KEY     *level[BOARD];
+static int     level_size[BOARD];
+static KEY     *reach[BOARD];
+static int     reach_size[BOARD];
+static long    solution_count = 0;
 
 /******************************/
 /*  Global data declarations  */
@@ -104,13 +231,227 @@ static int     hash_check_point;
 #define HASH_1(k)         ((k) % PRIME_1)
 #define HASH_2(k)         ((unsigned int)1 + (k) % PRIME_2)
 #define DOUBLE_HASH(k,i)  (HASH_1(HASH_1(k) + (i) * HASH_2(k)))
+#define FRONTIER_HASH(p)  ((int)((BOARD_KEY(p) * 0x9e3779b97f4a7c15ULL) >>     \
+                             (64 - frontier_bits)))
+#define FRONTIER_PART(p)  ((int)(HASH_1(BOARD_KEY(p)) % frontier_parts))
 #define SH(p,n)           (((p)->id & ((unsigned int)1 << (n))) ? '*' : '.')
 #define SH_SL(p)          (((p)->slack & 1) ? '*' : '.')
+#define BIT_ID(n)         (((n) == SL) ? 0u : ((unsigned int)1 << ((n) & 31)))
+#define BIT_SL(n)         (((n) == SL) ? 1 : 0)
+#define MOVE(pinh,next,nxt2)                                          \
+  { BIT_ID(next) | BIT_ID(nxt2),                                      \
+    BIT_ID(pinh) | BIT_ID(next) | BIT_ID(nxt2),                       \
+    BIT_SL(next) | BIT_SL(nxt2),                                      \
+    BIT_SL(pinh) | BIT_SL(next) | BIT_SL(nxt2),                       \
+    pinh, next, nxt2 }
+#define MOVE_LEGAL(p,next,nxt2)                                        \
+  (((p)->id & (BIT_ID(next) | BIT_ID(nxt2))) ==                        \
+     (BIT_ID(next) | BIT_ID(nxt2)) &&                                  \
+   ((p)->slack & (BIT_SL(next) | BIT_SL(nxt2))) ==                     \
+     (BIT_SL(next) | BIT_SL(nxt2)))
+/* move loops unrolled per pinhole, see 'PINHOLE_MOVES'; these use    */
+/* the local variables of 'solve_pin', 'pin_moves' and 'pin_undo'     */
+#define CASE_PIN(pin,moves)  case pin: moves break;
+#define SOLVE_MOVE(j,pinh,next,nxt2)                                   \
+  if (!done && MOVE_LEGAL(actual_p, next, nxt2))                       \
+  { /* traversal optimization */                                       \
+    if ((j) < last &&                                                  \
+      ((BIT_ID(pinh) | BIT_ID(next) | BIT_ID(nxt2)) & last_id) == 0 && \
+      ((BIT_SL(pinh) | BIT_SL(next) | BIT_SL(nxt2)) & last_slack) == 0)\
+    { /* no collision -> already done, as are the next moves */        \
+      break;                                                           \
+    }                                                                  \
+    new_state.id    = actual_p->id ^                                   \
+      (BIT_ID(pinh) | BIT_ID(next) | BIT_ID(nxt2));                    \
+    new_state.slack = ((actual_p->slack ^                              \
+      (BIT_SL(pinh) | BIT_SL(next) | BIT_SL(nxt2))) & 1);              \
+    new_state.pins  = actual_p->pins - 1;                              \
+    move[actual_p->pins]       = j;                                    \
+    move_state[actual_p->pins] = new_state;                            \
+    done = solve(&new_state, phase);                                   \
+  }
+#define LIST_MOVE(j,pinh,next,nxt2)                                    \
+  if (MOVE_LEGAL(actual_p, next, nxt2)) { cand[n++] = j; }
+#define UNDO_MOVE(j,pinh,next,nxt2)                                    \
+  if ((actual_p->id & (BIT_ID(next) | BIT_ID(nxt2))) == 0 &&           \
+    (actual_p->slack & (BIT_SL(next) | BIT_SL(nxt2))) == 0)            \
+  { cand[n++] = j;                                                     \
+  }
+#define PAGODA(n)         ((hole_row[n] % 2 == 0 && hole_col[n] % 2 == 0) ? 1 : 0)
+#define SHARD_END         (~(KEY)0)
+#define SHARD_OWNER(k)    ((int)(HASH_1(k) % shard_count))
+#define BOARD_KEY(p)      ((KEY)(p)->id | ((KEY)((p)->slack & 1) << SL))
+
+/******************************/
+/*  Move table                */
+/******************************/
+
+/* All possible moves, grouped per pinhole [0..BOARD-1] in the        */
+/* direction order up, right, down, left. Only legal jumps are        */
+/* listed. The pinhole numbering (see 'show_state') is chosen in such */
+/* a way that 'rotate_state' is done at 'byte' level.                 */
+/* PINHOLE_MOVES calls PIN(pinh, moves) for each pinhole, the moves   */
+/* being J(index, pinh, next, nxt2); from it the table is set up and  */
+/* the move loops are unrolled (see 'solve_pin'). The numbering of    */
+/* the moves is checked at compile time; a build with CHECK_TABLE     */
+/* defined checks all of it against the board layout at the start    */
+/* (see 'check_table').                                               */
+
+#define PINHOLE_MOVES(PIN, J)                      \
+  PIN( 0, J( 0,  0,  1,  2) J( 1,  0,  3,  6)) \
+  PIN( 1, J( 2,  1,  4,  7))                   \
+  PIN( 2, J( 3,  2,  5, 14) J( 4,  2,  1,  0)) \
+  PIN( 3, J( 5,  3,  4,  5) J( 6,  3,  6, 31)) \
+  PIN( 4, J( 7,  4,  7, SL))                   \
+  PIN( 5, J( 8,  5, 14, 15) J( 9,  5,  4,  3)) \
+  PIN( 6, J(10,  6,  3,  0) J(11,  6,  7, 14)  \
+          J(12,  6, 31, 30) J(13,  6, 29, 26)) \
+  PIN( 7, J(14,  7,  4,  1) J(15,  7, 14, 11)  \
+          J(16,  7, SL, 23) J(17,  7,  6, 29)) \
+  PIN( 8, J(18,  8,  9, 10) J(19,  8, 11, 14)) \
+  PIN( 9, J(20,  9, 12, 15))                   \
+  PIN(10, J(21, 10,  9,  8) J(22, 10, 13, 22)) \
+  PIN(11, J(23, 11, 12, 13) J(24, 11, 14,  7)) \
+  PIN(12, J(25, 12, 15, SL))                   \
+  PIN(13, J(26, 13, 12, 11) J(27, 13, 22, 23)) \
+  PIN(14, J(28, 14,  5,  2) J(29, 14, 11,  8)  \
+          J(30, 14, 15, 22) J(31, 14,  7,  6)) \
+  PIN(15, J(32, 15, 14,  5) J(33, 15, 12,  9)  \
+          J(34, 15, 22, 19) J(35, 15, SL, 31)) \
+  PIN(16, J(36, 16, 19, 22) J(37, 16, 17, 18)) \
+  PIN(17, J(38, 17, 20, 23))                   \
+  PIN(18, J(39, 18, 21, 30) J(40, 18, 17, 16)) \
+  PIN(19, J(41, 19, 22, 15) J(42, 19, 20, 21)) \
+  PIN(20, J(43, 20, 23, SL))                   \
+  PIN(21, J(44, 21, 30, 31) J(45, 21, 20, 19)) \
+  PIN(22, J(46, 22, 15, 14) J(47, 22, 13, 10)  \
+          J(48, 22, 19, 16) J(49, 22, 23, 30)) \
+  PIN(23, J(50, 23, SL,  7) J(51, 23, 22, 13)  \
+          J(52, 23, 20, 17) J(53, 23, 30, 27)) \
+  PIN(24, J(54, 24, 25, 26) J(55, 24, 27, 30)) \
+  PIN(25, J(56, 25, 28, 31))                   \
+  PIN(26, J(57, 26, 29,  6) J(58, 26, 25, 24)) \
+  PIN(27, J(59, 27, 28, 29) J(60, 27, 30, 23)) \
+  PIN(28, J(61, 28, 31, SL))                   \
+  PIN(29, J(62, 29,  6,  7) J(63, 29, 28, 27)) \
+  PIN(30, J(64, 30, 31,  6) J(65, 30, 23, 22)  \
+          J(66, 30, 21, 18) J(67, 30, 27, 24)) \
+  PIN(31, J(68, 31,  6,  3) J(69, 31, SL, 15)  \
+          J(70, 31, 30, 21) J(71, 31, 28, 25)) \
+  PIN(SL, J(72, SL,  7,  4) J(73, SL, 15, 12)  \
+          J(74, SL, 23, 20) J(75, SL, 31, 28))
+
+#define TABLE_PIN(pin, moves)            moves
+#define TABLE_MOVE(j, pinh, next, nxt2)  MOVE(pinh, next, nxt2),
+
+static const UPDATE  table[MOVES] =
+{ PINHOLE_MOVES(TABLE_PIN, TABLE_MOVE)
+};
+
+/* the moves must be numbered 0..MOVES-1 in the order listed; else an */
+/* array of negative size is declared                                 */
+#define ENUM_MOVE(j, pinh, next, nxt2)   MOVE_NUMBER_##j,
+#define CHECK_MOVE(j, pinh, next, nxt2)                                \
+  typedef char  check_move_##j[(MOVE_NUMBER_##j == (j)) ? 1 : -1];
+
+enum move_number { PINHOLE_MOVES(TABLE_PIN, ENUM_MOVE) MOVE_NUMBERS };
+PINHOLE_MOVES(TABLE_PIN, CHECK_MOVE)
+typedef char  check_moves[(MOVE_NUMBERS == MOVES) ? 1 : -1];
+
+/* Position (row, column) of each pinhole on the 7x7 playfield.       */
+
+static const int  hole_row[BOARD] =
+{ 0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 4, 2, 3, 4, 2, 3,
+  6, 6, 6, 5, 5, 5, 4, 4, 4, 3, 2, 4, 3, 2, 4, 3,
+  3
+};
+
+static const int  hole_col[BOARD] =
+{ 2, 3, 4, 2, 3, 4, 2, 3, 6, 6, 6, 5, 5, 5, 4, 4,
+  4, 3, 2, 4, 3, 2, 4, 3, 0, 0, 0, 1, 1, 1, 2, 2,
+  3
+};
+
+/* pinhole mirrored in column d (the same row) */
+static const int  hole_mirror[BOARD] =
+{ 2, 1, 0, 5, 4, 3,14, 7,26,25,24,29,28,27, 6,31,
+ 18,17,16,21,20,19,30,23,10, 9, 8,13,12,11,22,15,
+ 32
+};
+
+static const char  *join_name[]  = { "probe", "merge" };
+static const char  *cache_name[] = { "exact", "depth", "always", "two-tier" };
+static const char  *order_name[] = { "bits", "center", "isolated",
+                                     "history", "pagoda" };
 
 /******************************/
 /*  Local operations          */
 /******************************/
 
+/**********************************************************************/
+/*                                                                    */
+/* Operation: mem_realloc                                             */
+/*                                                                    */
+/* Abstract : Allocate or reallocate memory, as realloc does.         */
+/* Returns  : pointer to the memory                                   */
+/* In       : size  #of bytes, 0 is taken as 1                        */
+/* In/Out   : ptr   memory to reallocate or a null pointer            */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : If no memory is available the program (or the worker)   */
+/*            exits.                                                  */
+/*                                                                    */
+/**********************************************************************/
+
+static void*
+mem_realloc(void *ptr, size_t size)
+{
+  if ((ptr = realloc(ptr, (size > 0) ? size : 1)) == NULL)
+  { printf("Out of memory.\n");
+#ifdef SHARDS
+    if (shard_self >= 0)
+    { fflush(stdout);
+      _exit(1);
+    }
+#endif
+    exit(1);
+  }
+
+  return ptr;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: cache_statistics                                        */
+/*                                                                    */
+/* Abstract : Display information about the hash table in cache mode. */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+cache_statistics(void)
+{
+  if (cache_mode != CACHE_EXACT)
+  { printf("Cache (%s, %d entries): %lld lookups, %.1f%c hits, "
+      "%lld evictions, %lld not stored.\n",
+      cache_name[cache_mode], hash_size, cache_lookups,
+      cache_lookups ? (double)cache_hits * 100 / cache_lookups : 0.0, '%',
+      cache_evictions, cache_dropped);
+    /* the cache forgets states, so one state may be dropped often */
+    printf("Frontier (%d entries): %d states at depth %d, "
+      "%lld drops.\n",
+      frontier_size, frontier_count, PINS_LEFT, frontier_dropped);
+  }
+
+  return;
+}
+
 /**********************************************************************/
 /*                                                                    */
 /* Operation: hash_statistics                                         */
@@ -138,7 +479,10 @@ hash_statistics(int verbose)
       i, hash_added_overflow, hash_match_overflow);
   }
   printf("Hash table %d%c full.\n",
-    hash_added_total * 100 / HASH_SIZ, '%');
+    (int)((double)hash_added_total * 100 / hash_size), '%');
+  if (verbose)
+  { cache_statistics();
+  }
 
   return;
 }
@@ -148,8 +492,11 @@ hash_statistics(int verbose)
 /* Operation: hash_init                                               */
 /*                                                                    */
 /* Abstract : Initialize all hash table variables and statistics.     */
+/*            In exact mode all HASH_SIZ entries are used, in cache   */
+/*            mode 'cache_entries' (the memory cap) and an empty      */
+/*            frontier table (see 'frontier_add').                    */
 /* Returns  : -                                                       */
-/* In       : -                                                       */
+/* In       : mode  CACHE_EXACT or a cache replacement policy         */
 /* In/Out   : -                                                       */
 /* Out      : -                                                       */
 /* Pre      : -                                                       */
@@ -158,10 +505,26 @@ hash_statistics(int verbose)
 /**********************************************************************/
 
 static void
-hash_init(void)
+hash_init(int mode)
 { int  i;
 
-  for (i = 0; i < HASH_SIZ; i++)
+  cache_mode      = mode;
+  hash_size       = (mode == CACHE_EXACT) ? HASH_SIZ : cache_entries;
+  cache_buckets   = hash_size / CACHE_WAYS;
+  cache_next      = 0;
+  cache_lookups   = 0;
+  cache_hits      = 0;
+  cache_evictions = 0;
+  cache_dropped   = 0;
+
+  free(frontier);
+  frontier         = NULL;
+  frontier_size    = 0;
+  frontier_bits    = 0;
+  frontier_count   = 0;
+  frontier_dropped = 0;
+
+  for (i = 0; i < hash_size; i++)
   { hash[i].pins      = 0;
     hash[i].id        = 0;
     hash[i].slack     = 0;
@@ -174,7 +537,7 @@ hash_init(void)
   hash_added_total    = 0;
   hash_match_overflow = 0;
   hash_percent        = 10;
-  hash_check_point    = HASH_SIZ * 10 / 100;
+  hash_check_point    = hash_size * 10 / 100;
 
   return;
 }
@@ -242,12 +605,402 @@ rotate_state(STATE *actual_p, STATE *rotate_p, int rotate_count)
   return rotated;
 }
 
+/**********************************************************************/
+/*                                                                    */
+/* Operation: mirror_state                                            */
+/*                                                                    */
+/* Abstract : Mirror state in the middle column (see 'hole_mirror').  */
+/* Returns  : -                                                       */
+/* In       : actual_p  origin state being mirrored                   */
+/* In/Out   : -                                                       */
+/* Out      : mirror_p  resulting state after mirroring               */
+/* Pre      : actual_p and mirror_p must point to proper states       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+mirror_state(STATE *actual_p, STATE *mirror_p)
+{ int  pin;
+
+  *mirror_p    = *actual_p;
+  mirror_p->id = 0;
+  for (pin = 0; pin < PINS; pin++)
+  { if (actual_p->id & BIT_ID(pin))
+    { mirror_p->id |= BIT_ID(hole_mirror[pin]);
+    }
+  }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: hash_count                                              */
+/*                                                                    */
+/* Abstract : Update the statistics for a state stored in an empty    */
+/*            entry.                                                  */
+/* Returns  : -                                                       */
+/* In       : i  #of probes (exact) or entry in bucket (cache)        */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : this statistics are displayed regularly                 */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+hash_count(int i)
+{
+  if (i < HASH_HIST) { hash_added[i]++; } else { hash_added_overflow++; }
+  if (++hash_added_total > hash_check_point)
+  { hash_statistics(0);
+    hash_percent += 10;
+    hash_check_point = hash_size * hash_percent / 100;
+  }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: frontier_search                                         */
+/*                                                                    */
+/* Abstract : Search a state in the frontier table.                   */
+/* Returns  : 0 if found or -1 if not                                 */
+/* In       : rotate_p  pointer to (rotated) state to search          */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : rotate_p must not be a null pointer                     */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+frontier_search(STATE *rotate_p)
+{ int  entry;
+
+  if (frontier_size == 0) { return -1; }
+
+  for (entry = FRONTIER_HASH(rotate_p); frontier[entry].id != 0;
+    entry = (entry + 1) & (frontier_size - 1))
+  { if (frontier[entry].id == rotate_p->id &&
+      (frontier[entry].slack & 1) == (rotate_p->slack & 1))
+    { return 0;
+    }
+  }
+
+  return -1;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: frontier_add                                            */
+/*                                                                    */
+/* Abstract : Add a state at depth PINS_LEFT in cache mode. Phase 2   */
+/*            needs these states, so they are kept apart from the     */
+/*            cache in a table of their own (linear probing, a power  */
+/*            of two in size), which is doubled when it is 3/4 full.  */
+/*            Under a memory cap the table has 'frontier_max' entries */
+/*            from the start, and states are dropped once it is 3/4   */
+/*            full; only the states of the frontier parts of this     */
+/*            pass are kept (see 'frontier_retry').                   */
+/* Returns  : 0 if added (or not stored) or 1 if already in table     */
+/* In       : rotate_p  pointer to (rotated) state to add             */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : rotate_p must not be a null pointer                     */
+/* Post     : If no memory is available the program exits.            */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+frontier_add(STATE *rotate_p)
+{ STATE  *old    = frontier;
+  int    old_size = frontier_size;
+  int    i, entry, part;
+
+  if (frontier_parts > 1 && (part = FRONTIER_PART(rotate_p)) !=
+    frontier_part[0] && part != frontier_part[1])
+  { return 0;
+  }
+  if (frontier_search(rotate_p) == 0)
+  { return 1;
+  }
+
+  if (4 * (frontier_count + 1) > 3 * frontier_size)
+  { if (frontier_max > 0 && frontier_size == frontier_max)
+    { if (frontier_dropped++ == 0)
+      { printf("Frontier table full at the memory cap, "
+          "states at depth %d are dropped.\n", PINS_LEFT);
+      }
+      return 0;
+    }
+    frontier_size = (frontier_max > 0) ? frontier_max :
+      (old_size == 0) ? 1024 : 2 * old_size;
+    for (frontier_bits = 0; (1 << frontier_bits) < frontier_size;
+      frontier_bits++)
+    { ;
+    }
+    frontier = (STATE*)mem_realloc(NULL, frontier_size * sizeof(STATE));
+    memset(frontier, 0, frontier_size * sizeof(STATE));
+    frontier_count = 0;
+    for (i = 0; i < old_size; i++)
+    { if (old[i].id != 0) { frontier_add(&old[i]); }
+    }
+    free(old);
+  }
+
+  for (entry = FRONTIER_HASH(rotate_p); frontier[entry].id != 0;
+    entry = (entry + 1) & (frontier_size - 1))
+  { ;
+  }
+  frontier[entry] = *rotate_p;
+  frontier_count++;
+
+  return 0;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: frontier_retry                                          */
+/*                                                                    */
+/* Abstract : Select the frontier parts of the next pass of phases 1  */
+/*            and 2, after a pass in which states at depth PINS_LEFT  */
+/*            were dropped yielded no meeting point. The frontier is  */
+/*            split in parts (by hash), two of which are kept in each */
+/*            pass; as a meeting point joins two frontier states,     */
+/*            trying all pairs of parts misses none of them. Parts    */
+/*            not fitting in the table together are split further.   */
+/* Returns  : 1 if a pass is left or 0 if not                         */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : a pass is done                                          */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+frontier_retry(void)
+{
+  if (frontier_dropped > 0)
+  { frontier_parts   = (frontier_parts == 1) ? 3 : 2 * frontier_parts;
+    frontier_part[0] = 0;
+    frontier_part[1] = 1;
+  }
+  else if (frontier_parts == 1)
+  { return 0;
+  }
+  else if (++frontier_part[1] == frontier_parts)
+  { if (++frontier_part[0] == frontier_parts - 1) { return 0; }
+    frontier_part[1] = frontier_part[0] + 1;
+  }
+  printf("Retrying with frontier parts %d and %d of %d.\n",
+    frontier_part[0] + 1, frontier_part[1] + 1, frontier_parts);
+
+  return 1;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: frontier_states                                         */
+/*                                                                    */
+/* Abstract : Give the table holding the states at depth PINS_LEFT:   */
+/*            the hash table in exact mode, else the frontier table.  */
+/*            Other states in it are to be skipped by their pins.     */
+/* Returns  : the table                                               */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : size_p  #of entries in the table                        */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static STATE*
+frontier_states(int *size_p)
+{
+  if (cache_mode == CACHE_EXACT)
+  { *size_p = HASH_SIZ;
+    return hash;
+  }
+  *size_p = frontier_size;
+
+  return frontier;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: cache_victim                                            */
+/*                                                                    */
+/* Abstract : Select the entry of a bucket to be replaced.            */
+/* Returns  : entry in bucket or -1 if all entries are kept           */
+/* In       : bucket   first entry of the bucket                      */
+/*            first    first entry to consider                        */
+/*            last     entry after the last one to consider           */
+/*            shallow  1 to select the state with the least pins left */
+/*                     (least work lost), 0 to select round robin     */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+cache_victim(STATE *bucket, int first, int last, int shallow)
+{ int  i, k, victim = -1;
+
+  for (k = 0; k < last - first; k++)
+  { i = first + (shallow ? k : (cache_next + k) % (last - first));
+    if (victim == -1 || bucket[i].pins < bucket[victim].pins)
+    { victim = i;
+      if (!shallow)
+      { cache_next++;
+        break;
+      }
+    }
+  }
+
+  return victim;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: cache_add                                               */
+/*                                                                    */
+/* Abstract : Add a state to the hash table in cache mode. If the     */
+/*            bucket of the state is full an entry is replaced:       */
+/*            CACHE_DEPTH     the state with the least pins left,     */
+/*                            unless the new state has even less      */
+/*            CACHE_ALWAYS    round robin                             */
+/*            CACHE_TWO_TIER  a depth-preferred tier as CACHE_DEPTH;  */
+/*                            states not kept there go to an always-  */
+/*                            replace tier, as CACHE_ALWAYS           */
+/*            A state not stored is only searched again later. States */
+/*            at depth PINS_LEFT go to the frontier table instead.    */
+/* Returns  : 0 if added (or not stored) or 1 if already in table     */
+/* In       : rotate_p  pointer to (rotated) state to add             */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : rotate_p must not be a null pointer                     */
+/* Post     : hash and cache statistics are updated                   */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+cache_add(STATE *rotate_p)
+{ STATE  *bucket = &hash[HASH_1(rotate_p->id) % cache_buckets * CACHE_WAYS];
+  int    i, victim = -1;
+
+  if (rotate_p->pins == PINS_LEFT)
+  { return frontier_add(rotate_p);
+  }
+
+  cache_lookups++;
+  for (i = 0; i < CACHE_WAYS; i++)
+  { if (bucket[i].id == rotate_p->id &&
+      (bucket[i].slack & 1) == (rotate_p->slack & 1))
+    { hash_match[i]++;
+      cache_hits++;
+      return 1;
+    }
+  }
+  for (i = 0; i < CACHE_WAYS; i++)
+  { if (bucket[i].id == 0)
+    { bucket[i] = *rotate_p;
+      hash_count(i);
+      return 0;
+    }
+  }
+
+  switch (cache_mode)
+  { case CACHE_DEPTH:
+      victim = cache_victim(bucket, 0, CACHE_WAYS, 1);
+      if (victim != -1 && bucket[victim].pins > rotate_p->pins)
+      { victim = -1;
+      }
+      break;
+    case CACHE_ALWAYS:
+      victim = cache_victim(bucket, 0, CACHE_WAYS, 0);
+      break;
+    case CACHE_TWO_TIER:
+      victim = cache_victim(bucket, 0, CACHE_TIER, 1);
+      if (victim != -1 && bucket[victim].pins <= rotate_p->pins)
+      { /* the replaced state moves to the always-replace tier */
+        if ((i = cache_victim(bucket, CACHE_TIER, CACHE_WAYS, 0)) != -1)
+        { bucket[i] = bucket[victim];
+        }
+      }
+      else
+      { victim = cache_victim(bucket, CACHE_TIER, CACHE_WAYS, 0);
+      }
+      break;
+  }
+
+  if (victim == -1)
+  { cache_dropped++;
+  }
+  else
+  { bucket[victim] = *rotate_p;
+    cache_evictions++;
+  }
+
+  return 0;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: hash_to_cache                                           */
+/*                                                                    */
+/* Abstract : Continue with a full exact hash table as a two-tier     */
+/*            cache. Only the states at depth PINS_LEFT are kept, in  */
+/*            the frontier table.                                     */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the hash table is in exact mode                         */
+/* Post     : the hash table is in cache mode.                        */
+/*            If no memory is available the program exits.            */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+hash_to_cache(void)
+{ STATE  *kept;
+  int    i, n = 0;
+
+  hash_statistics(1);
+  printf("Hash table full, continuing as %s cache.\n",
+    cache_name[CACHE_TWO_TIER]);
+
+  for (i = 0; i < HASH_SIZ; i++)
+  { if (hash[i].pins == PINS_LEFT) { hash[n++] = hash[i]; }
+  }
+  kept = (STATE*)mem_realloc(NULL, n * sizeof(STATE));
+  memcpy(kept, hash, n * sizeof(STATE));
+
+  for (i = cache_entries; i < HASH_SIZ; i++)
+  { hash[i].pins  = 0;
+    hash[i].id    = 0;
+    hash[i].slack = 0;
+  }
+  hash_init(CACHE_TWO_TIER);
+  for (i = 0; i < n; i++) { frontier_add(&kept[i]); }
+  free(kept);
+
+  return;
+}
+
 /**********************************************************************/
 /*                                                                    */
 /* Operation: hash_add                                                */
 /*                                                                    */
-/* Abstract : Add a state to the hash table.                          */
-/* Returns  : 0 if added, 1 if already in table or -1 if table full   */
+/* Abstract : Add a state to the hash table. If the table is full in  */
+/*            exact mode it continues in cache mode.                  */
+/* Returns  : 0 if added (or not stored) or 1 if already in table     */
 /* In       : actual_p  pointer to state to add                       */
 /* In/Out   : -                                                       */
 /* Out      : -                                                       */
@@ -259,43 +1012,39 @@ rotate_state(STATE *actual_p, STATE *rotate_p, int rotate_count)
 
 static int
 hash_add(STATE *actual_p)
-{ int    ret_val = -1;
-  int    i;
+{ int    i;
   int    entry;
   STATE  rotate;
 
   rotate_state(actual_p, &rotate, -1);
 
+  if (cache_mode != CACHE_EXACT)
+  { return cache_add(&rotate);
+  }
+
   for (i = 0; i < HASH_SIZ; i++)
   { entry = DOUBLE_HASH(rotate.id, i);
     if (hash[entry].id == 0)
     { hash[entry] = rotate;
+      hash_count(i);
 
-      if (i < HASH_HIST) { hash_added[i]++; } else { hash_added_overflow++; }
-      if (++hash_added_total > hash_check_point)
-      { hash_statistics(0);
-        hash_percent += 10;
-        hash_check_point = HASH_SIZ * hash_percent / 100;
-      }
-
-      ret_val = 0;
-      break;
+      return 0;
     }
     if (hash[entry].id == rotate.id &&
       (hash[entry].slack & 1) == (rotate.slack & 1))
     {
       if (i < HASH_HIST) { hash_match[i]++; } else { hash_match_overflow++; }
 
-      ret_val = 1;
-      break;
+      return 1;
     }
   }
 
-  if (ret_val == -1) { hash_match_overflow++; }
+  hash_match_overflow++;
+  hash_to_cache();
 
-  return ret_val;
+  return cache_add(&rotate);
 }
-
+
 /**********************************************************************/
 /*                                                                    */
 /* Operation: hash_search                                             */
@@ -319,6 +1068,20 @@ hash_search(STATE *actual_p)
 
   rotate_state(actual_p, &rotate, -1);
 
+  if (cache_mode != CACHE_EXACT && rotate.pins == PINS_LEFT)
+  { return frontier_search(&rotate);
+  }
+  if (cache_mode != CACHE_EXACT)
+  { entry = HASH_1(rotate.id) % cache_buckets * CACHE_WAYS;
+    for (i = entry; i < entry + CACHE_WAYS; i++)
+    { if (hash[i].id == rotate.id &&
+        (hash[i].slack & 1) == (rotate.slack & 1))
+      { ret_val = 0;
+      }
+    }
+    return ret_val;
+  }
+
   for (i = 0; i < HASH_SIZ; i++)
   { entry = DOUBLE_HASH(rotate.id, i);
     if (hash[entry].id == 0)
@@ -333,7 +1096,7 @@ hash_search(STATE *actual_p)
 
   return ret_val;
 }
-
+
 /**********************************************************************/
 /*                                                                    */
 /* Operation: show_state                                              */
@@ -371,16 +1134,12 @@ show_state(STATE *p)
 
 /**********************************************************************/
 /*                                                                    */
-/* Operation: initialize_entry                                        */
+/* Operation: show_solution                                           */
 /*                                                                    */
-/* Abstract : Initialize entry in table. Each entry indicates a       */
-/*            possible move. Bitmaps are filled; they are used to     */
-/*            determine the result of this move within a given state. */
+/* Abstract : Display states of a complete solution.                  */
+/*            The user is being asked to give input after each state. */
 /* Returns  : -                                                       */
-/* In       : pinh  the actual board position (pinhole) [0..BOARD-1]  */
-/*            idx   indicated the move direction [0..3]               */
-/*            next  pin being jumped over when the move is done       */
-/*            nxt2  pin jumping to the pinhole (pinh)                 */
+/* In       : -                                                       */
 /* In/Out   : -                                                       */
 /* Out      : -                                                       */
 /* Pre      : -                                                       */
@@ -389,94 +1148,9 @@ show_state(STATE *p)
 /**********************************************************************/
 
 static void
-initialize_entry(int pinh, int idx, int next, int nxt2)
-{
-  if (next == -1 || nxt2 == -1)
-  { table[4*pinh + idx].allowed =  0;
-  }
-  else
-  { table[4*pinh + idx].allowed =  1;
-    table[4*pinh + idx].rank    =  4*pinh + idx;
-    
-    table[4*pinh + idx].next_id    =  (next == SL) ? 0 : (1 << next);
-    table[4*pinh + idx].next_slack =  (((next == SL) ? 1 : 0) & 1);
-    table[4*pinh + idx].next_id    |= (nxt2 == SL) ? 0 : (1 << nxt2);
-    table[4*pinh + idx].next_slack |= (((nxt2 == SL) ? 1 : 0) & 1);
-
-    table[4*pinh + idx].mask_id    =  (pinh == SL) ? 0 : (1 << pinh);
-    table[4*pinh + idx].mask_slack =  (((pinh == SL) ? 1 : 0) & 1);
-    table[4*pinh + idx].mask_id    |= table[4*pinh + idx].next_id;
-    table[4*pinh + idx].mask_slack |= ((table[4*pinh + idx].next_slack) & 1);
-  }
-
-  return;
-}
-
-/**********************************************************************/
-/*                                                                    */
-/* Operation: initialize_table                                        */
-/*                                                                    */
-/* Abstract : Fill table with all possible moves.                     */
-/*            Identity all pinholes and initialize each move (4 ones) */
-/*            possible jumping to this pinhole.                       */
-/* Returns  : -                                                       */
-/* In       : -                                                       */
-/* In/Out   : -                                                       */
-/* Out      : -                                                       */
-/* Pre      : -                                                       */
-/* Post     : The ordering is done in such a way that 'rotate_state'  */
-/*            (see above) is done at 'byte' level.                    */
-/*                                                                    */
-/**********************************************************************/
-
-static void
-initialize_table(void)
-{        int  i;
-  static int  arr[121] = 
-  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1,  0,  1,  2, -1, -1, -1, -1,
-    -1, -1, -1, -1,  3,  4,  5, -1, -1, -1, -1,
-    -1, -1, 26, 29,  6,  7, 14, 11,  8, -1, -1,
-    -1, -1, 25, 28, 31, SL, 15, 12,  9, -1, -1,
-    -1, -1, 24, 27, 30, 23, 22, 13, 10, -1, -1,
-    -1, -1, -1, -1, 21, 20, 19, -1, -1, -1, -1,
-    -1, -1, -1, -1, 18, 17, 16, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
-  };
-
-  for (i = 0; i < 121; i++)
-  { if (arr[i] != -1)
-    { initialize_entry(arr[i], 0, arr[i - 11], arr[i - 22]);
-      initialize_entry(arr[i], 1, arr[i +  1], arr[i +  2]);
-      initialize_entry(arr[i], 2, arr[i + 11], arr[i + 22]);
-      initialize_entry(arr[i], 3, arr[i -  1], arr[i -  2]);
-    }
-  }
-
-  return;
-}
-
-/**********************************************************************/
-/*                                                                    */
-/* Operation: show_solution                                           */
-/*                                                                    */
-/* Abstract : Display states of a complete solution.                  */
-/*            The user is being asked to give input after each state. */
-/* Returns  : -                                                       */
-/* In       : -                                                       */
-/* In/Out   : -                                                       */
-/* Out      : -                                                       */
-/* Pre      : -                                                       */
-/* Post     : -                                                       */
-/*                                                                    */
-/**********************************************************************/
-
-static void
-show_solution(void)
-{ int  i;
-  int  tmp;
+show_solution(void)
+{ int  i;
+  int  tmp;
 
   solution_move_state[PINS] = start_state;
   solution_move_state[1]    = final_state;
@@ -556,7 +1230,7 @@ check_phase3_result(STATE *actual_p)
 
 static int
 check_phase2_result(STATE *actual_p)
-{ int    done = 0;
+{ int    done = 0, found;
   STATE  rotate;
   int    i;
 
@@ -564,7 +1238,19 @@ check_phase2_result(STATE *actual_p)
   rotate.slack = ((~actual_p->slack) & 1);
   rotate.pins  = PINS_LEFT;
 
-  if (hash_search(&rotate) == 0)
+#ifdef SHARDS
+  if (shard_count > 0 && !shard_replay)
+  { /* the heading frontier is spread over the shards */
+    return shard_probe(state_key(&rotate));
+  }
+  if (shard_count > 0)
+  { found = state_key(&rotate) == shard_hit;
+  }
+  else
+#endif
+  { found = hash_search(&rotate) == 0;
+  }
+  if (found)
   { printf(" found.\n");
     real_final = rotate;
     rotate_state(&real_final, &rotated_final, -1);
@@ -583,10 +1269,14 @@ check_phase2_result(STATE *actual_p)
 /* Operation: solve_pin                                               */
 /*                                                                    */
 /* Abstract : Solve state starting with a move to specific pinhole.   */
+/*            The moves are unrolled per pinhole, their masks being   */
+/*            constants (see 'SOLVE_MOVE').                           */
 /* Returns  : 0 if not done of 1 if done                              */
 /* In       : actual_p  pointer to state being solved                 */
-/*            pin_4     first move (of 4) being possible              */
+/*            pin       pinhole being jumped to [0..BOARD-1]          */
 /*            phase     determines stage of the solution process      */
+/*            last      move leading to the state, -1 if the moves    */
+/*                      before it are not to be skipped               */
 /* In/Out   : -                                                       */
 /* Out      : -                                                       */
 /* Pre      : -                                                       */
@@ -595,42 +1285,141 @@ check_phase2_result(STATE *actual_p)
 /**********************************************************************/
 
 static int
-solve_pin(STATE *actual_p, int pin_4, int phase)
-{ int     done = 0;
-  STATE   new_state;
-  UPDATE  *update_p, *last_update_p;
-  int     j;
+solve_pin(STATE *actual_p, int pin, int phase, int last)
+{ int             done = 0;
+  STATE           new_state;
+  unsigned int    last_id    = 0;
+  unsigned short  last_slack = 0;
+
+  if (last >= 0)
+  { last_id    = table[last].mask_id;
+    last_slack = table[last].mask_slack & 1;
+  }
 
-  for (j = 0; j < 4 && !done; j++)
-  { update_p = &table[pin_4 + j];
+  switch (pin)
+  { PINHOLE_MOVES(CASE_PIN, SOLVE_MOVE)
+  }
+ 
+  return done;
+}
 
-    if (update_p->allowed &&
-      (actual_p->id & update_p->next_id) == update_p->next_id &&
-      (actual_p->slack & update_p->next_slack & 1) == update_p->next_slack)
-    {
-      /* traversal optimization */
-      if (actual_p->pins < PINS_LEFT)
-      { last_update_p = &table[move[actual_p->pins + 1]];
-        if (update_p->rank < last_update_p->rank &&
-          (update_p->mask_id & last_update_p->mask_id) == 0 &&
-          (update_p->mask_slack & last_update_p->mask_slack & 1) == 0)
-        { /* no collision -> already done */
-          break;
-        }
-      }
-      new_state.id    = actual_p->id ^ update_p->mask_id;
-      new_state.slack = ((actual_p->slack ^ update_p->mask_slack) & 1);
-      new_state.pins  = actual_p->pins  - 1;
+/**********************************************************************/
+/*                                                                    */
+/* Operation: pin_moves                                               */
+/*                                                                    */
+/* Abstract : Determine the moves to a specific pinhole possible in a */
+/*            state, unrolled as in 'solve_pin'.                      */
+/* Returns  : #of possible moves                                      */
+/* In       : actual_p  pointer to state                              */
+/*            pin       pinhole being jumped to [0..BOARD-1]          */
+/* In/Out   : -                                                       */
+/* Out      : cand      moves (index in table) in table order         */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+pin_moves(const STATE *actual_p, int pin, int cand[4])
+{ int  n = 0;
+
+  switch (pin)
+  { PINHOLE_MOVES(CASE_PIN, LIST_MOVE)
+  }
+
+  return n;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: pin_undo                                                */
+/*                                                                    */
+/* Abstract : Determine the moves from a specific pinhole which can   */
+/*            be undone in a state, unrolled as in 'solve_pin'.       */
+/* Returns  : #of moves which can be undone                           */
+/* In       : actual_p  pointer to state                              */
+/*            pin       pinhole jumped to [0..BOARD-1], holding a pin */
+/* In/Out   : -                                                       */
+/* Out      : cand      moves (index in table) in table order         */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+pin_undo(const STATE *actual_p, int pin, int cand[4])
+{ int  n = 0;
+
+  switch (pin)
+  { PINHOLE_MOVES(CASE_PIN, UNDO_MOVE)
+  }
+
+  return n;
+}
 
-      move[actual_p->pins] = pin_4 + j;
-      move_state[actual_p->pins] = new_state;
-      done = solve(&new_state, phase);
+/**********************************************************************/
+/*                                                                    */
+/* Operation: state_moves                                             */
+/*                                                                    */
+/* Abstract : Determine all moves possible in a state, or all moves   */
+/*            which can be undone in it, per pinhole (see 'pin_moves' */
+/*            and 'pin_undo').                                        */
+/* Returns  : #of moves                                               */
+/* In       : actual_p  pointer to state                              */
+/*            undo      1 for the moves to be undone or 0 if not      */
+/* In/Out   : -                                                       */
+/* Out      : cand      moves (index in table) in table order         */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+state_moves(const STATE *actual_p, int undo, int cand[MOVES])
+{ int  pin, filled, n = 0;
+
+  for (pin = 0; pin < BOARD; pin++)
+  { filled = (pin == SL) ? (actual_p->slack & 1) != 0 :
+      (actual_p->id & BIT_ID(pin)) != 0;
+    if (undo && filled)
+    { n += pin_undo(actual_p, pin, cand + n);
+    }
+    else if (!undo && !filled)
+    { n += pin_moves(actual_p, pin, cand + n);
     }
   }
- 
-  return done;
+
+  return n;
 }
-
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: apply_move                                              */
+/*                                                                    */
+/* Abstract : Determine the state following a state by a move. As a   */
+/*            move only exchanges pins and holes, the same is done to */
+/*            undo it; the #of pins is then set by the caller.        */
+/* Returns  : -                                                       */
+/* In       : actual_p  pointer to state                              */
+/*            j         the move [0..MOVES-1]                         */
+/* In/Out   : -                                                       */
+/* Out      : new_p     pointer to the following state                */
+/* Pre      : the move is possible in the state                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+apply_move(const STATE *actual_p, int j, STATE *new_p)
+{ const UPDATE  *update_p = &table[j];
+
+  new_p->id    = actual_p->id ^ update_p->mask_id;
+  new_p->slack = ((actual_p->slack ^ update_p->mask_slack) & 1);
+  new_p->pins  = actual_p->pins - 1;
+
+  return;
+}
+
 /**********************************************************************/
 /*                                                                    */
 /* Operation: solve_sub                                               */
@@ -649,21 +1438,194 @@ solve_pin(STATE *actual_p, int pin_4, int phase)
 static int
 solve_sub(STATE *actual_p, int phase)
 { int           done = 0;
-  int           pin;
+  int           pin, last = -1;
   unsigned int  bit;
 
+  if (actual_p->pins < PINS_LEFT)
+  { /* phase 2: moves commuting with the last one are already done */
+    last = move[actual_p->pins + 1];
+  }
   for (pin = 0, bit = 1; pin < PINS && !done; pin++, bit <<= 1)
   { if ((actual_p->id & bit) == 0)
-    { done = solve_pin(actual_p, 4 * pin, phase);
+    { done = solve_pin(actual_p, pin, phase, last);
     }
   }
   if (!done && (actual_p->slack & 1) == 0)
-  { done = solve_pin(actual_p, 4 * SL, phase);
+  { done = solve_pin(actual_p, SL, phase, last);
   }
 
   return done;
 }
 
+/**********************************************************************/
+/*                                                                    */
+/* Operation: initialize_order                                        */
+/*                                                                    */
+/* Abstract : Initialize the move ordering data: the neighbouring     */
+/*            pinholes of each pinhole (taken from the move table)    */
+/*            and the history counters.                               */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+initialize_order(void)
+{ int  j;
+
+  for (j = 0; j < BOARD; j++)
+  { order_neighbours[j] = 0;
+  }
+  for (j = 0; j < MOVES; j++)
+  { order_neighbours[table[j].pinh] |= (KEY)1 << table[j].next;
+    order_neighbours[table[j].next] |= (KEY)1 << table[j].pinh;
+    order_neighbours[table[j].next] |= (KEY)1 << table[j].nxt2;
+    order_neighbours[table[j].nxt2] |= (KEY)1 << table[j].next;
+    order_history[j] = 0;
+  }
+  order_nodes  = 0;
+  order_probes = 0;
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: order_score                                             */
+/*                                                                    */
+/* Abstract : Score a move according to the move ordering policy;     */
+/*            moves with a higher score are tried first.              */
+/*            ORDER_CENTER   prefers jumps ending near the center.    */
+/*            ORDER_ISOLATED prefers the fewest pins left without a   */
+/*                           neighbouring pin.                        */
+/*            ORDER_HISTORY  prefers moves having had the most probes */
+/*                           of the trailing frontier below them so   */
+/*                           far. As phase 2 stops at the first hit,  */
+/*                           these probes all missed: the moves with  */
+/*                           the largest subtrees come first.         */
+/*            ORDER_PAGODA   prefers the least loss of the pagoda     */
+/*                           value, a pagoda function being a weight  */
+/*                           per pinhole that never increases by a    */
+/*                           move. Weight 1 is given to the pinholes  */
+/*                           at an even row and even column.          */
+/* Returns  : score of the move                                       */
+/* In       : new_p  pointer to state after the move                  */
+/*            j      the move [0..MOVES-1]                            */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static COUNT
+order_score(STATE *new_p, int j)
+{ const UPDATE  *update_p = &table[j];
+        KEY     board;
+        COUNT   score = 0;
+        int     pin;
+
+  switch (order_mode)
+  { case ORDER_CENTER:
+      score = - abs(hole_row[update_p->pinh] - 3)
+              - abs(hole_col[update_p->pinh] - 3);
+      break;
+    case ORDER_ISOLATED:
+      board = BOARD_KEY(new_p);
+      for (pin = 0; pin < BOARD; pin++)
+      { if ((board & ((KEY)1 << pin)) && (board & order_neighbours[pin]) == 0)
+        { score--;
+        }
+      }
+      break;
+    case ORDER_HISTORY:
+      score = order_history[j];
+      break;
+    case ORDER_PAGODA:
+      score = PAGODA(update_p->pinh) - PAGODA(update_p->next)
+            - PAGODA(update_p->nxt2);
+      break;
+  }
+
+  return score;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: solve_ordered                                           */
+/*                                                                    */
+/* Abstract : Solve all following states possible from the actual,    */
+/*            trying the moves in the order of the move ordering      */
+/*            policy (see 'order_score'). Used in phase 2 for all     */
+/*            policies but ORDER_BITS, skipping the same moves as     */
+/*            'solve_sub' does.                                       */
+/* Returns  : 0 if not done or 1 if done                              */
+/* In       : actual_p  pointer to state being solved                 */
+/*            phase     determines stage of the solution process      */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : 'initialize_order' is done                              */
+/* Post     : The history counters are updated.                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+solve_ordered(STATE *actual_p, int phase)
+{       int     done = 0;
+        STATE   new_state;
+        int     legal[MOVES], cand[MOVES];
+        COUNT   score[MOVES], sc, probes;
+  const UPDATE  *update_p, *last_update_p;
+        int     i, j, k, n_legal, n = 0, skip = -1;
+
+  n_legal = state_moves(actual_p, 0, legal);
+  for (k = 0; k < n_legal; k++)
+  { j        = legal[k];
+    update_p = &table[j];
+    if (update_p->pinh == skip)
+    { continue;
+    }
+    /* traversal optimization */
+    if (actual_p->pins < PINS_LEFT)
+    { last_update_p = &table[move[actual_p->pins + 1]];
+      if (j < move[actual_p->pins + 1] &&
+        (update_p->mask_id & last_update_p->mask_id) == 0 &&
+        (update_p->mask_slack & last_update_p->mask_slack & 1) == 0)
+      { /* no collision -> already done, as are the next moves to */
+        /* this pinhole                                            */
+        skip = update_p->pinh;
+        continue;
+      }
+    }
+    apply_move(actual_p, j, &new_state);
+
+    /* insert sorted, equal scores keep the table order */
+    sc = order_score(&new_state, j);
+    for (i = n++; i > 0 && score[i - 1] < sc; i--)
+    { cand[i]  = cand[i - 1];
+      score[i] = score[i - 1];
+    }
+    cand[i]  = j;
+    score[i] = sc;
+  }
+
+  for (i = 0; i < n && !done; i++)
+  { apply_move(actual_p, cand[i], &new_state);
+    move[actual_p->pins] = cand[i];
+    move_state[actual_p->pins] = new_state;
+    probes = order_probes;
+    done = solve(&new_state, phase);
+    /* probes below the move, all of them misses if not done */
+    order_history[cand[i]] += order_probes - probes;
+  }
+
+  return done;
+}
+
 /**********************************************************************/
 /*                                                                    */
 /* Operation: solve                                                   */
@@ -675,25 +1637,29 @@ solve_sub(STATE *actual_p, int phase)
 /* In/Out   : -                                                       */
 /* Out      : -                                                       */
 /* Pre      : -                                                       */
-/* Post     : If the hash table is full the program exits.            */
+/* Post     : -                                                       */
 /*                                                                    */
 /**********************************************************************/
 
 static int
 solve(STATE *actual_p, int phase)
 { int  done = 0;
-  int  hash_result;
 
   if (phase == 2)
-  { if (actual_p->pins == BOARD - PINS_LEFT)
-    { done = check_phase2_result(actual_p);
+  { order_nodes++;
+    if (actual_p->pins == BOARD - PINS_LEFT)
+    { order_probes++;
+      done = check_phase2_result(actual_p);
+    }
+    else if (order_mode != ORDER_BITS)
+    { done = solve_ordered(actual_p, phase);
     }
     else
     { done = solve_sub(actual_p, phase);
     }
   }
   else
-  { if ((hash_result = hash_add(actual_p)) == 0)
+  { if (hash_add(actual_p) == 0)
     { if (actual_p->pins == PINS_LEFT)
       { if (phase == 3)
         { done = check_phase3_result(actual_p);
@@ -703,45 +1669,68 @@ solve(STATE *actual_p, int phase)
       { done = solve_sub(actual_p, phase);
       }
     }
-    else
-    { if (hash_result == -1)
-      { hash_statistics(1);
-        exit(1);
-      }
-    }
   }
  
   return done;
 }
 
-/******************************/
-/*  Global operations         */
-/******************************/
+/**********************************************************************/
+/*                                                                    */
+/* Operation: state_key                                               */
+/*                                                                    */
+/* Abstract : Determine the key of a state, being the id and slack    */
+/*            of its best rotation (see 'rotate_state').              */
+/* Returns  : key  canonical key of the state                         */
+/* In       : actual_p  pointer to state                              */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : actual_p must not be a null pointer                     */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static KEY
+state_key(STATE *actual_p)
+{ STATE  rotate;
+
+  rotate_state(actual_p, &rotate, -1);
+
+  return ((KEY)rotate.id << 1) | (KEY)(rotate.slack & 1);
+}
 
 /**********************************************************************/
 /*                                                                    */
-/* Operation: main                                                    */
+/* Operation: key_state                                               */
 /*                                                                    */
-/* Abstract : Solve the solitaire problem.                            */
-/*            The solotion process is split up in three phases:       */
-/*            Phase 1 sets up a hash table in which all possible      */
-/*                    states are stored at depth PINS_LEFT.           */
-/*                    Note that the states at depth BOARD - PINS_LEFT */
-/*                    are the same states, but reversed.              */
-/*            Phase 2 finds a path between depth PINS_LEFT (the       */
-/*                    heading frontier) and BOARD - PINS_LEFT (the    */
-/*                    trailing frontier). The clue is to match a      */
-/*                    reversed state of the depth first traversal     */
-/*                    with a state of the trailing frontier.          */
-/*                    This is done using the hash table.              */
-/*            Phase 3 again creates the hash table but keeps in mind  */
-/*                    that the two states indicating the head and     */
-/*                    (reversed) tail (of the path found in Phase 2)  */
-/*                    must be found for their parts of the solution.  */
-/*            Finally the solution is obtained when the result of     */
-/*            phase 2 is combined with the result of phase 3.         */
-/* Returns  : 0                                                       */
-/* In       : -                                                       */
+/* Abstract : Convert a key back to a (rotated) state.                */
+/* Returns  : -                                                       */
+/* In       : key   key of the state                                  */
+/*            pins  #of pins of the state                             */
+/* In/Out   : -                                                       */
+/* Out      : actual_p  resulting state                               */
+/* Pre      : actual_p must not be a null pointer                     */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+key_state(KEY key, int pins, STATE *actual_p)
+{
+  actual_p->id    = (unsigned int)(key >> 1);
+  actual_p->slack = (unsigned short)(key & 1);
+  actual_p->pins  = (unsigned short)pins;
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: key_reverse                                             */
+/*                                                                    */
+/* Abstract : Determine the key of the reversed state (all pins and   */
+/*            pinholes swapped).                                      */
+/* Returns  : key  canonical key of the reversed state                */
+/* In       : key   key of the state                                  */
 /* In/Out   : -                                                       */
 /* Out      : -                                                       */
 /* Pre      : -                                                       */
@@ -749,28 +1738,2017 @@ solve(STATE *actual_p, int phase)
 /*                                                                    */
 /**********************************************************************/
 
-int
-main(void)
-{ int  i, done;
+static KEY
+key_reverse(KEY key)
+{ STATE  rotate;
 
-  initialize_table();
+  key_state(key, 0, &rotate);
+  rotate.id    = ~rotate.id;
+  rotate.slack = ((~rotate.slack) & 1);
 
-  printf("Phase 1: full search from %d to %d.\n", PINS, PINS_LEFT);
-  hash_init();
-  solve(&start_state, 1);
+  return state_key(&rotate);
+}
 
-  printf("Phase 2: traversal from %d to %d.\n", PINS_LEFT, BOARD - PINS_LEFT);
-  printf("searching..."); fflush(stdout);
-  for (i = done = 0; i < HASH_SIZ && !done; i++)
-  { if (hash[i].pins == PINS_LEFT)
-    { rotated_start = hash[i];
-      done = solve(&rotated_start, 2);
+/**********************************************************************/
+/*                                                                    */
+/* Operation: key_compare                                             */
+/*                                                                    */
+/* Abstract : Compare two keys (qsort and bsearch callback).          */
+/* Returns  : -1, 0 or 1 if first key is less, equal or greater       */
+/* In       : p1, p2  pointers to the keys                            */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+key_compare(const void *p1, const void *p2)
+{ KEY  k1 = *(const KEY*)p1;
+  KEY  k2 = *(const KEY*)p2;
+
+  return (k1 < k2) ? -1 : (k1 > k2) ? 1 : 0;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: key_grow                                                */
+/*                                                                    */
+/* Abstract : Double the allocated size of an array of keys.          */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : arr_p  array, reallocated                               */
+/*            max_p  #of keys allocated                               */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : If no memory is available the program exits.            */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+key_grow(KEY **arr_p, int *max_p)
+{
+  *max_p = (*max_p == 0) ? 1024 : *max_p * 2;
+  *arr_p = (KEY*)mem_realloc(*arr_p, *max_p * sizeof(KEY));
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: key_append                                              */
+/*                                                                    */
+/* Abstract : Append a key to a growing array of keys.                */
+/* Returns  : -                                                       */
+/* In       : key  key to append                                      */
+/* In/Out   : arr_p  array, reallocated when full                     */
+/*            n_p    #of keys in the array                            */
+/*            max_p  #of keys allocated                               */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : If no memory is available the program exits.            */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+key_append(KEY **arr_p, int *n_p, int *max_p, KEY key)
+{
+  if (*n_p == *max_p) { key_grow(arr_p, max_p); }
+  (*arr_p)[(*n_p)++] = key;
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: key_sort                                                */
+/*                                                                    */
+/* Abstract : Sort an array of keys and remove the duplicates.        */
+/*            Keys hold KEY_BITS bits, so a radix sort is done in     */
+/*            passes of KEY_RADIX bits using a scratch array.         */
+/* Returns  : #of distinct keys left in the array                     */
+/* In       : n    #of keys in the array                              */
+/* In/Out   : arr  array of keys                                      */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : If no memory is available the program exits.            */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+key_sort(KEY *arr, int n)
+{ static int  count[1 << KEY_RADIX];
+         KEY  *src = arr, *dst, *tmp;
+         int  i, j, sum, shift;
+
+  if (n == 0) { return 0; }
+
+  dst = (KEY*)mem_realloc(NULL, n * sizeof(KEY));
+  for (shift = 0; shift < KEY_BITS; shift += KEY_RADIX)
+  { for (i = 0; i < (1 << KEY_RADIX); i++) { count[i] = 0; }
+    for (i = 0; i < n; i++)
+    { count[(src[i] >> shift) & ((1 << KEY_RADIX) - 1)]++;
+    }
+    for (i = sum = 0; i < (1 << KEY_RADIX); i++)
+    { j = count[i];
+      count[i] = sum;
+      sum += j;
+    }
+    for (i = 0; i < n; i++)
+    { dst[count[(src[i] >> shift) & ((1 << KEY_RADIX) - 1)]++] = src[i];
+    }
+    tmp = src; src = dst; dst = tmp;
+  }
+
+  /* unique while copying back */
+  arr[0] = src[0];
+  for (i = j = 1; i < n; i++)
+  { if (src[i] != arr[j - 1]) { arr[j++] = src[i]; }
+  }
+  free((src == arr) ? dst : src);
+
+  return j;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: key_merge                                               */
+/*                                                                    */
+/* Abstract : Add keys to a sorted array of distinct keys. The new    */
+/*            keys are sorted (see 'key_sort') and merged backwards   */
+/*            into the array, so only room for the new keys is needed */
+/*            besides the array.                                      */
+/* Returns  : #of distinct keys                                       */
+/* In       : u    #of sorted distinct keys at the start of the array */
+/*            n    #of keys in the array                              */
+/* In/Out   : arr  array of keys                                      */
+/* Out      : -                                                       */
+/* Pre      : arr[0..u-1] is sorted and contains distinct keys        */
+/* Post     : arr[0..return-1] is sorted and contains distinct keys.  */
+/*            If no memory is available the program exits.            */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+key_merge(KEY *arr, int u, int n)
+{ KEY  *tail;
+  int  i, j, k, t;
+
+  if ((t = key_sort(arr + u, n - u)) == 0 || u == 0) { return u + t; }
+
+  tail = (KEY*)mem_realloc(NULL, t * sizeof(KEY));
+  memcpy(tail, arr + u, t * sizeof(KEY));
+  for (i = u - 1, j = t - 1, k = u + t; j >= 0; )
+  { if (i >= 0 && arr[i] > tail[j])
+    { arr[--k] = arr[i--];
+    }
+    else
+    { if (i >= 0 && arr[i] == tail[j]) { i--; }
+      arr[--k] = tail[j--];
+    }
+  }
+  /* close the gap left by the duplicates */
+  memmove(arr + i + 1, arr + k, (u + t - k) * sizeof(KEY));
+  free(tail);
+
+  return i + 1 + u + t - k;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: key_gallop                                              */
+/*                                                                    */
+/* Abstract : Skip forward in a sorted array to the first key not     */
+/*            less than 'key'. Steps are doubled until passed, then   */
+/*            a binary search is done within the last step.           */
+/* Returns  : index of the first key >= 'key' (or n if none)          */
+/* In       : arr  sorted array of keys                               */
+/*            pos  actual position, arr[pos] < key                    */
+/*            n    #of keys in the array                              */
+/*            key  key to skip to                                     */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+key_gallop(const KEY *arr, int pos, int n, KEY key)
+{ int  step = 1;
+  int  lo, hi, mid;
+
+  while (pos + step < n && arr[pos + step] < key)
+  { pos  += step;
+    step *= 2;
+  }
+  lo = pos + 1;
+  hi = (pos + step < n) ? pos + step : n;
+  while (lo < hi)
+  { mid = lo + (hi - lo) / 2;
+    if (arr[mid] < key) { lo = mid + 1; } else { hi = mid; }
+  }
+
+  return lo;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: key_intersect                                           */
+/*                                                                    */
+/* Abstract : Intersect two sorted arrays of distinct keys. Both      */
+/*            arrays are streamed; runs of keys without a match are   */
+/*            skipped using 'key_gallop'.                             */
+/* Returns  : #of keys in the intersection                            */
+/* In       : a, na  first sorted array and its #of keys              */
+/*            b, nb  second sorted array and its #of keys             */
+/* In/Out   : -                                                       */
+/* Out      : out    keys present in both arrays (sorted)             */
+/* Pre      : out must hold at least min(na, nb) keys                 */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+key_intersect(const KEY *a, int na, const KEY *b, int nb, KEY *out)
+{ int  i = 0, j = 0, n = 0;
+
+  while (i < na && j < nb)
+  { if (a[i] == b[j])
+    { out[n++] = a[i++];
+      j++;
+    }
+    else if (a[i] < b[j])
+    { i = key_gallop(a, i, na, b[j]);
+    }
+    else
+    { j = key_gallop(b, j, nb, a[i]);
+    }
+  }
+
+  return n;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: key_successors                                          */
+/*                                                                    */
+/* Abstract : Determine the keys of all states following a state.     */
+/* Returns  : #of following states                                    */
+/* In       : key   key of the state                                  */
+/*            pins  #of pins of the state                             */
+/* In/Out   : -                                                       */
+/* Out      : succ  keys of the following states                      */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+key_successors(KEY key, int pins, KEY succ[MOVES])
+{ STATE  actual, new_state;
+  int    cand[MOVES];
+  int    j, n;
+
+  key_state(key, pins, &actual);
+  n = state_moves(&actual, 0, cand);
+  for (j = 0; j < n; j++)
+  { apply_move(&actual, cand[j], &new_state);
+    succ[j] = state_key(&new_state);
+  }
+
+  return n;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: level_expand                                            */
+/*                                                                    */
+/* Abstract : Create the sorted level of all states having one pin    */
+/*            less than the states of level 'pins'.                   */
+/* Returns  : -                                                       */
+/* In       : pins  level being expanded                              */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : level[pins] is sorted and contains distinct keys        */
+/* Post     : level[pins - 1] is sorted and contains distinct keys    */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+level_expand(int pins)
+{ KEY  succ[MOVES];
+  int  i, j, n_succ, u = 0, n = 0, max = 0;
+  KEY  *arr = NULL;
+
+  for (i = 0; i < level_size[pins]; i++)
+  { n_succ = key_successors(level[pins][i], pins, succ);
+    for (j = 0; j < n_succ; j++)
+    { if (n == max)
+      { /* merge the new keys, grow if little room is left for them */
+        n = u = key_merge(arr, u, n);
+        if (max - u < u / 2 + 1024)
+        { max = 2 * u + 1024;
+          arr = (KEY*)mem_realloc(arr, max * sizeof(KEY));
+        }
+      }
+      arr[n++] = succ[j];
+    }
+  }
+
+  n = key_merge(arr, u, n);
+  if (n > 0 && n < max)
+  { /* release the room left for new keys */
+    if ((level[pins - 1] = (KEY*)realloc(arr, n * sizeof(KEY))) == NULL)
+    { level[pins - 1] = arr;
+    }
+  }
+  else
+  { level[pins - 1] = arr;
+  }
+  level_size[pins - 1] = n;
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: level_free                                              */
+/*                                                                    */
+/* Abstract : Release all levels.                                     */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+level_free(void)
+{ int  i;
+
+  for (i = 0; i < BOARD; i++)
+  { free(level[i]);
+    level[i]      = NULL;
+    level_size[i] = 0;
+  }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: walk_back                                               */
+/*                                                                    */
+/* Abstract : Walk back from a state to depth 'pins' by undoing moves */
+/*            (depth first). Only states accepted by 'accept' are     */
+/*            walked through, so the walk is as cheap as this test is */
+/*            strict.                                                 */
+/* Returns  : 0 if not done or 1 if done                              */
+/* In       : actual_p  pointer to the state to start from            */
+/*            pins      #of pins to walk back to                      */
+/*            accept    test on each state walked back to; at depth   */
+/*                      'pins' it decides if the walk is done         */
+/* In/Out   : -                                                       */
+/* Out      : path  states from actual_p->pins up to pins             */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+walk_back(STATE *actual_p, int pins, int (*accept)(STATE *actual_p),
+  STATE path[BOARD])
+{ STATE  new_state;
+  int    cand[MOVES];
+  int    k, n;
+
+  path[actual_p->pins] = *actual_p;
+  if (actual_p->pins == pins)
+  { return 1;
+  }
+  n = state_moves(actual_p, 1, cand);
+  for (k = 0; k < n; k++)
+  { apply_move(actual_p, cand[k], &new_state);
+    new_state.pins = actual_p->pins + 1;
+    if (accept(&new_state) && walk_back(&new_state, pins, accept, path))
+    { return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: level_heading                                           */
+/*                                                                    */
+/* Abstract : Test for 'walk_back' to the heading frontier: a state   */
+/*            at depth PINS_LEFT must be found in the hash table. As  */
+/*            only a few moves are undone, the states in between are  */
+/*            not tested and no levels need to be kept for this.      */
+/* Returns  : 1 if accepted or 0 if not                               */
+/* In       : actual_p  pointer to state                              */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the hash table is filled by phase 1                     */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+level_heading(STATE *actual_p)
+{
+  return actual_p->pins != PINS_LEFT || hash_search(actual_p) == 0;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: level_path                                              */
+/*                                                                    */
+/* Abstract : Recover the middle part of the solution through a       */
+/*            meeting point. The heading part of the path is walked   */
+/*            back from the meeting point, the trailing part from its */
+/*            reversed state (reversed again). The resulting chain of */
+/*            keys is replayed forwards from the heading frontier     */
+/*            state to obtain the actual states.                      */
+/* Returns  : 0 if not done or 1 if done                              */
+/* In       : meet  key of the meeting point at depth LEVEL_MEET      */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the hash table is filled by phase 1                     */
+/* Post     : If done then the middle part of the solution is stored. */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+level_path(KEY meet)
+{ KEY    chain[BOARD];
+  STATE  path[BOARD], actual, new_state;
+  int    cand[MOVES];
+  int    pins, k, n;
+
+  key_state(meet, LEVEL_MEET, &actual);
+  if (!walk_back(&actual, PINS_LEFT, level_heading, path)) { return 0; }
+  for (pins = LEVEL_MEET; pins <= PINS_LEFT; pins++)
+  { chain[pins] = state_key(&path[pins]);
+  }
+  key_state(key_reverse(meet), BOARD - LEVEL_MEET, &actual);
+  if (!walk_back(&actual, PINS_LEFT, level_heading, path)) { return 0; }
+  for (pins = BOARD - LEVEL_MEET; pins <= PINS_LEFT; pins++)
+  { chain[BOARD - pins] = key_reverse(state_key(&path[pins]));
+  }
+
+  key_state(chain[PINS_LEFT], PINS_LEFT, &rotated_start);
+  actual = rotated_start;
+  for (pins = PINS_LEFT; pins > BOARD - PINS_LEFT; pins--)
+  { n = state_moves(&actual, 0, cand);
+    for (k = 0; k < n; k++)
+    { apply_move(&actual, cand[k], &new_state);
+      if (state_key(&new_state) == chain[pins - 1]) { break; }
+    }
+    if (k == n) { return 0; }
+    move[pins]       = cand[k];
+    move_state[pins] = new_state;
+    actual           = new_state;
+  }
+
+  return check_phase2_result(&actual);
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: phase2_probe                                            */
+/*                                                                    */
+/* Abstract : Find the meeting point by depth first traversal from    */
+/*            each state of the heading frontier, probing the hash    */
+/*            table at depth BOARD - PINS_LEFT.                       */
+/* Returns  : 0 if not done or 1 if done                              */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the hash table is filled by phase 1                     */
+/* Post     : If done then the middle part of the solution is stored. */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+phase2_probe(void)
+{ STATE  *states;
+  int    i, n, done;
+
+  printf("Phase 2: traversal from %d to %d (%s order).\n",
+    PINS_LEFT, BOARD - PINS_LEFT, order_name[order_mode]);
+  printf("searching..."); fflush(stdout);
+  initialize_order();
+  states = frontier_states(&n);
+  for (i = done = 0; i < n && !done; i++)
+  { if (states[i].pins == PINS_LEFT)
+    { rotated_start = states[i];
+      done = solve(&rotated_start, 2);
+    }
+  }
+  if (!done)
+  { printf(" not found.\n");
+  }
+  printf("%lld nodes visited, %lld frontier states probed.\n",
+    order_nodes, order_probes);
+
+  return done;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: phase2_merge                                            */
+/*                                                                    */
+/* Abstract : Find the meeting points by joining sorted levels.      */
+/*            The heading frontier is expanded level by level down to */
+/*            BOARD - LEVEL_MEET. As the states of the trailing part  */
+/*            are the reversed states of the heading part, a state at */
+/*            depth LEVEL_MEET is on a path if its reversed state is  */
+/*            at depth BOARD - LEVEL_MEET. Intersecting level         */
+/*            LEVEL_MEET with the reversed level BOARD - LEVEL_MEET   */
+/*            gives all states at depth LEVEL_MEET on a path at once; */
+/*            the path is recovered for the first one. Levels above LEVEL_MEET are released */
+/*            as soon as they are expanded.                           */
+/* Returns  : 0 if not done or 1 if done                              */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the hash table is filled by phase 1                     */
+/* Post     : If done then the middle part of the solution is stored. */
+/*            The levels are released.                                */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+phase2_merge(void)
+{ KEY    *trailing, *meet;
+  STATE  *states;
+  int    i, n, max = 0, n_meet, pins, done = 0;
+
+  printf("Phase 2: expansion from %d to %d, sorted join of level %d "
+    "with reversed level %d.\n",
+    PINS_LEFT, BOARD - LEVEL_MEET, LEVEL_MEET, BOARD - LEVEL_MEET);
+  states = frontier_states(&n);
+  for (i = 0; i < n; i++)
+  { if (states[i].pins == PINS_LEFT)
+    { key_append(&level[PINS_LEFT], &level_size[PINS_LEFT], &max,
+        state_key(&states[i]));
+    }
+  }
+  level_size[PINS_LEFT] = key_sort(level[PINS_LEFT], level_size[PINS_LEFT]);
+
+  for (pins = PINS_LEFT; pins > BOARD - LEVEL_MEET; pins--)
+  { level_expand(pins);
+    printf("level %2d: %9d states\n", pins - 1, level_size[pins - 1]);
+    if (pins != LEVEL_MEET)
+    { /* only the two levels being joined are kept */
+      free(level[pins]);
+      level[pins]      = NULL;
+      level_size[pins] = 0;
+    }
+  }
+
+  /* reversed states of depth BOARD - LEVEL_MEET, in place */
+  n        = level_size[BOARD - LEVEL_MEET];
+  trailing = level[BOARD - LEVEL_MEET];
+  for (i = 0; i < n; i++)
+  { trailing[i] = key_reverse(trailing[i]);
+  }
+  n = key_sort(trailing, n);
+  meet = (KEY*)mem_realloc(NULL, n * sizeof(KEY));
+
+  printf("searching..."); fflush(stdout);
+  n_meet = key_intersect(level[LEVEL_MEET], level_size[LEVEL_MEET],
+    trailing, n, meet);
+  printf(" %d states at depth %d on a path,", n_meet, LEVEL_MEET);
+  if (n_meet > 0)
+  { done = level_path(meet[0]);
+  }
+  if (!done)
+  { printf(" none usable.\n");
+  }
+
+  free(meet);
+  level_free();
+
+  return done;
+}
+
+#ifdef SHARDS
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_io                                                */
+/*                                                                    */
+/* Abstract : Read or write a complete buffer on a (blocking) pipe.   */
+/* Returns  : 0 if done or -1 if the pipe failed or is closed         */
+/* In       : fd      file descriptor of the pipe                     */
+/*            size    #of bytes                                       */
+/*            output  1 to write or 0 to read                         */
+/* In/Out   : buf     data being read or written                      */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+shard_io(int fd, void *buf, size_t size, int output)
+{ char     *p = (char*)buf;
+  ssize_t  r;
+
+  while (size > 0)
+  { r = output ? write(fd, p, size) : read(fd, p, size);
+    if (r < 0 && errno == EINTR) { continue; }
+    if (r <= 0) { return -1; }
+    p    += r;
+    size -= (size_t)r;
+  }
+
+  return 0;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_add                                               */
+/*                                                                    */
+/* Abstract : Add a key to the next level of this shard. The keys are */
+/*            merged (see 'key_merge') whenever the level is full, so */
+/*            duplicates do not pile up, as in 'level_expand'.        */
+/* Returns  : -                                                       */
+/* In       : key  key to add                                         */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : If no memory is available the worker exits.             */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_add(KEY key)
+{
+  if (shard_next_size == shard_next_max)
+  { shard_next_size = shard_next_sorted =
+      key_merge(shard_next, shard_next_sorted, shard_next_size);
+    if (shard_next_max - shard_next_sorted < shard_next_sorted / 2 + 1024)
+    { shard_next_max = 2 * shard_next_sorted + 1024;
+      shard_next = (KEY*)mem_realloc(shard_next,
+        shard_next_max * sizeof(KEY));
+    }
+  }
+  shard_next[shard_next_size++] = key;
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_receive                                           */
+/*                                                                    */
+/* Abstract : Take all keys being available in the inbox of this      */
+/*            shard. The keys are added to the next level; end of     */
+/*            level markers are counted.                              */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the inbox is non-blocking                               */
+/* Post     : If the inbox fails the worker exits.                    */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_receive(void)
+{ static char     buf[SHARD_BATCH * sizeof(KEY)];
+  static size_t   fill = 0;
+         KEY      key;
+         size_t   i;
+         ssize_t  r;
+
+  for (;;)
+  { r = read(shard_inbox, buf + fill, sizeof(buf) - fill);
+    if (r < 0 && errno == EINTR) { continue; }
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { break; }
+    if (r <= 0) { _exit(1); }
+
+    fill += (size_t)r;
+    for (i = 0; i + sizeof(KEY) <= fill; i += sizeof(KEY))
+    { memcpy(&key, buf + i, sizeof(KEY));
+      if (key == SHARD_END)
+      { shard_ends++;
+      }
+      else
+      { shard_add(key);
+      }
+    }
+    memmove(buf, buf + i, fill - i);
+    fill -= i;
+  }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_send                                              */
+/*                                                                    */
+/* Abstract : Send a batch of keys to the inbox of another shard.     */
+/*            While that inbox is full the own inbox is emptied, so   */
+/*            shards sending to each other never wait for each other. */
+/* Returns  : -                                                       */
+/* In       : to    shard receiving the keys                          */
+/*            keys  batch of keys                                     */
+/*            n     #of keys, at most SHARD_BATCH                     */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the pipes are non-blocking, a batch fits in PIPE_BUF    */
+/*            so it is written at once or not at all                  */
+/* Post     : If the pipe fails the worker exits.                     */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_send(int to, KEY *keys, int n)
+{ struct pollfd  fds[2];
+         ssize_t r;
+
+  for (;;)
+  { r = write(shard_outbox[to], keys, n * sizeof(KEY));
+    if (r == (ssize_t)(n * sizeof(KEY))) { break; }
+    if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+    { _exit(1);
+    }
+    fds[0].fd     = shard_outbox[to];
+    fds[0].events = POLLOUT;
+    fds[1].fd     = shard_inbox;
+    fds[1].events = POLLIN;
+    if (poll(fds, 2, -1) > 0 && (fds[1].revents & POLLIN))
+    { shard_receive();
+    }
+  }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_begin                                             */
+/*                                                                    */
+/* Abstract : Start building the next level of this shard.            */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_begin(void)
+{ int  to;
+
+  shard_next      = NULL;
+  shard_next_size = shard_next_sorted = shard_next_max = 0;
+  shard_ends      = 0;
+  for (to = 0; to < shard_count; to++) { shard_out_size[to] = 0; }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_route                                             */
+/*                                                                    */
+/* Abstract : Route a key to the next level of a shard. Keys for      */
+/*            other shards are sent in batches.                       */
+/* Returns  : -                                                       */
+/* In       : to   shard receiving the key                            */
+/*            key  key being routed                                   */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : 'shard_begin' is done                                   */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_route(int to, KEY key)
+{
+  if (to == shard_self)
+  { shard_add(key);
+  }
+  else
+  { shard_out[to][shard_out_size[to]++] = key;
+    if (shard_out_size[to] == SHARD_BATCH)
+    { shard_send(to, shard_out[to], shard_out_size[to]);
+      shard_out_size[to] = 0;
+    }
+  }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_end                                               */
+/*                                                                    */
+/* Abstract : Finish the next level of this shard: the batches left   */
+/*            are sent with an end of level marker, and keys of the   */
+/*            other shards are received up to their markers.          */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : 'shard_begin' is done                                   */
+/* Post     : shard_next holds the next level (sorted, distinct).     */
+/*            If the coordinator is gone the worker exits.            */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_end(void)
+{ struct pollfd  fds[2];
+         KEY     *tmp;
+         int     to;
+
+  for (to = 0; to < shard_count; to++)
+  { if (to != shard_self)
+    { shard_out[to][shard_out_size[to]++] = SHARD_END;
+      shard_send(to, shard_out[to], shard_out_size[to]);
+    }
+  }
+  while (shard_ends < shard_count - 1)
+  { fds[0].fd     = shard_inbox;
+    fds[0].events = POLLIN;
+    fds[1].fd     = shard_command;
+    fds[1].events = 0;
+    poll(fds, 2, -1);
+    if (fds[1].revents & (POLLHUP | POLLERR))
+    { /* coordinator gone */
+      _exit(1);
+    }
+    shard_receive();
+  }
+
+  shard_next_size = key_merge(shard_next, shard_next_sorted, shard_next_size);
+  if (shard_next_size > 0 && shard_next_size < shard_next_max &&
+    (tmp = (KEY*)realloc(shard_next, shard_next_size * sizeof(KEY))) != NULL)
+  { /* release the room left for new keys */
+    shard_next = tmp;
+  }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_worker                                            */
+/*                                                                    */
+/* Abstract : Main loop of a worker process owning one shard of the   */
+/*            states. On command of the coordinator the level is      */
+/*            expanded ('E') or the reversed level is joined with     */
+/*            level LEVEL_MEET ('J'), the #of states or meeting       */
+/*            points being reported back; the first meeting point is  */
+/*            handed over on 'F'. Of the heading frontier the next    */
+/*            SHARD_BATCH keys are handed over ('N'). A batch of keys */
+/*            is looked up in the level asked for ('L'); the levels   */
+/*            are kept for this, so the walk back of 'shard_path'     */
+/*            only goes through states reached from the start state.  */
+/* Returns  : - (the process exits)                                   */
+/* In       : self  number of this shard                              */
+/*            pins  #of pins of the initial level                     */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the pipes are set up by 'shard_solve'                   */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_worker(int self, int pins)
+{ KEY   succ[MOVES], probe[SHARD_BATCH], key, meet = 0;
+  char  found[SHARD_BATCH];
+  int   max = 0, next = 0;
+  int   i, j, n, n_succ, look, failed = 0;
+  char  cmd;
+
+  shard_self = self;
+  if (SHARD_OWNER(state_key(&start_state)) == self)
+  { key_append(&level[pins], &level_size[pins], &max, state_key(&start_state));
+  }
+
+  while (!failed && shard_io(shard_command, &cmd, 1, 0) == 0 && cmd != 'Q')
+  { if (cmd == 'E')
+    { shard_begin();
+      for (i = 0; i < level_size[pins]; i++)
+      { n_succ = key_successors(level[pins][i], pins, succ);
+        for (j = 0; j < n_succ; j++)
+        { shard_route(SHARD_OWNER(succ[j]), succ[j]);
+        }
+      }
+      shard_end();
+      pins--;
+      level[pins]      = shard_next;
+      level_size[pins] = shard_next_size;
+      failed = shard_io(shard_report, &level_size[pins], sizeof(int), 1);
+    }
+    else if (cmd == 'J')
+    { /* meeting points: keys of level LEVEL_MEET, reversed in this one */
+      shard_begin();
+      for (i = 0; i < level_size[pins]; i++)
+      { key = key_reverse(level[pins][i]);
+        shard_route(SHARD_OWNER(key), key);
+      }
+      shard_end();
+      /* in place, the level being kept for the walk back */
+      n = key_intersect(level[LEVEL_MEET], level_size[LEVEL_MEET],
+        shard_next, shard_next_size, shard_next);
+      if (n > 0) { meet = shard_next[0]; }
+      /* the reversed level is not walked through */
+      free(shard_next);
+      free(level[pins]);
+      level[pins]      = NULL;
+      level_size[pins] = 0;
+      failed = shard_io(shard_report, &n, sizeof(n), 1);
+    }
+    else if (cmd == 'F')
+    { failed = shard_io(shard_report, &meet, sizeof(meet), 1);
+    }
+    else if (cmd == 'N')
+    { n = (level_size[pins] - next < SHARD_BATCH) ?
+        level_size[pins] - next : SHARD_BATCH;
+      failed = shard_io(shard_report, &n, sizeof(n), 1) != 0 ||
+        (n > 0 &&
+         shard_io(shard_report, level[pins] + next, n * sizeof(KEY), 1) != 0);
+      next += n;
+    }
+    else if (cmd == 'L')
+    { failed = shard_io(shard_command, &look, sizeof(look), 0) != 0 ||
+        look < pins || look > PINS ||
+        shard_io(shard_command, &n, sizeof(n), 0) != 0 ||
+        n < 0 || n > SHARD_BATCH ||
+        shard_io(shard_command, probe, n * sizeof(KEY), 0) != 0;
+      for (i = 0; i < n && !failed; i++)
+      { found[i] = level_size[look] > 0 &&
+          bsearch(&probe[i], level[look], level_size[look], sizeof(KEY),
+            key_compare) != NULL;
+      }
+      failed = failed || shard_io(shard_report, found, n, 1) != 0;
+    }
+  }
+
+  _exit(0);
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_reports                                           */
+/*                                                                    */
+/* Abstract : Wait for the report of every worker, in whatever order  */
+/*            they come. A worker waiting for the end of level marker */
+/*            of a dead worker never reports, so the reports can not  */
+/*            be read one after the other.                            */
+/* Returns  : 0 if done or -1 if a worker died                        */
+/* In       : from  report pipes of the workers                       */
+/* In/Out   : -                                                       */
+/* Out      : n     #of states reported by each worker                */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+shard_reports(int from[SHARD_MAX], int n[SHARD_MAX])
+{ struct pollfd  fds[SHARD_MAX];
+         int     i, left;
+
+  for (i = 0; i < shard_count; i++)
+  { fds[i].fd     = from[i];
+    fds[i].events = POLLIN;
+  }
+  for (left = shard_count; left > 0; )
+  { if (poll(fds, shard_count, -1) < 0)
+    { if (errno == EINTR) { continue; }
+      return -1;
+    }
+    for (i = 0; i < shard_count; i++)
+    { if (fds[i].fd >= 0 && fds[i].revents != 0)
+      { /* a dead worker shows as end of file */
+        if (shard_io(fds[i].fd, &n[i], sizeof(n[i]), 0) != 0) { return -1; }
+        fds[i].fd = -1;
+        left--;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_stop                                              */
+/*                                                                    */
+/* Abstract : Stop all workers, and wait for them to exit.            */
+/* Returns  : -                                                       */
+/* In       : failed  1 if a worker or pipe failed, else 0            */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : If a worker failed the program exits. Otherwise the     */
+/*            SIGPIPE handler of before 'shard_solve' is restored.    */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_stop(int failed)
+{ int   i, status;
+  char  cmd = 'Q';
+
+  /* on failure the workers left may wait for a dead one forever */
+  for (i = 0; i < shard_count; i++)
+  { if (failed) { kill(shard_pid[i], SIGKILL); }
+    else        { shard_io(shard_to[i], &cmd, 1, 1); }
+  }
+  for (i = 0; i < shard_count; i++)
+  { close(shard_to[i]);
+    close(shard_from[i]);
+    if (waitpid(shard_pid[i], &status, 0) != shard_pid[i] ||
+      !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    { failed = 1;
+    }
+  }
+  if (failed)
+  { printf("Shard failed.\n");
+    exit(1);
+  }
+  signal(SIGPIPE, shard_sigpipe);
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_broadcast                                         */
+/*                                                                    */
+/* Abstract : Give all workers a command and wait for their reports.  */
+/* Returns  : -                                                       */
+/* In       : cmd   command                                           */
+/* In/Out   : -                                                       */
+/* Out      : count    #of keys reported by each worker               */
+/*            total_p  #of keys reported by all workers               */
+/* Pre      : -                                                       */
+/* Post     : If a worker or pipe failed the program exits.           */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_broadcast(char cmd, int count[SHARD_MAX], int *total_p)
+{ int  i;
+
+  for (i = 0; i < shard_count; i++)
+  { if (shard_io(shard_to[i], &cmd, 1, 1) != 0) { shard_stop(1); }
+  }
+  if (shard_reports(shard_from, count) != 0) { shard_stop(1); }
+  for (i = *total_p = 0; i < shard_count; i++)
+  { *total_p += count[i];
+  }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_ask                                               */
+/*                                                                    */
+/* Abstract : Have a shard look up keys in its part of a level.       */
+/* Returns  : -                                                       */
+/* In       : to    shard owning the keys                             */
+/*            look  #of pins of the level                             */
+/*            keys  keys to look up                                   */
+/*            n     #of keys [1..SHARD_BATCH]                         */
+/* In/Out   : -                                                       */
+/* Out      : found  1 for each key found or 0 if not                 */
+/* Pre      : the workers have expanded up to level 'look'            */
+/* Post     : If a worker or pipe failed the program exits.           */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_ask(int to, int look, KEY *keys, int n, char found[SHARD_BATCH])
+{ char  cmd = 'L';
+
+  if (shard_io(shard_to[to], &cmd, 1, 1) != 0 ||
+    shard_io(shard_to[to], &look, sizeof(look), 1) != 0 ||
+    shard_io(shard_to[to], &n, sizeof(n), 1) != 0 ||
+    shard_io(shard_to[to], keys, n * sizeof(KEY), 1) != 0 ||
+    shard_io(shard_from[to], found, n, 0) != 0)
+  { shard_stop(1);
+  }
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_lookup                                            */
+/*                                                                    */
+/* Abstract : Look up the probes kept for a shard in its part of the  */
+/*            heading frontier. The first hit is kept.                */
+/* Returns  : -                                                       */
+/* In       : to  shard owning the probes                             */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the workers have expanded up to the heading frontier    */
+/* Post     : If a worker or pipe failed the program exits.           */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+shard_lookup(int to)
+{ char  found[SHARD_BATCH];
+  int   i, n = shard_out_size[to];
+
+  shard_ask(to, PINS_LEFT, shard_out[to], n, found);
+  for (i = 0; i < n && shard_hit == SHARD_END; i++)
+  { if (found[i])
+    { shard_hit       = shard_out[to][i];
+      shard_hit_start = shard_origin[to][i];
+    }
+  }
+  shard_out_size[to] = 0;
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_probe                                             */
+/*                                                                    */
+/* Abstract : Keep a probe of phase 2 for the shard owning it, along  */
+/*            with the frontier state the traversal started from. The */
+/*            probes are looked up a batch at a time, so the hit is   */
+/*            known some probes later; the traversal is then ended    */
+/*            and redone from that frontier state (see 'shard_solve').*/
+/* Returns  : 1 if a hit is known or 0 if not                         */
+/* In       : key  key of the reversed state being probed             */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : shard_start is the key of the frontier state traversed  */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+shard_probe(KEY key)
+{ int  to = SHARD_OWNER(key);
+
+  shard_origin[to][shard_out_size[to]] = shard_start;
+  shard_out[to][shard_out_size[to]++]  = key;
+  if (shard_out_size[to] == SHARD_BATCH)
+  { shard_lookup(to);
+  }
+
+  return shard_hit != SHARD_END;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_member                                            */
+/*                                                                    */
+/* Abstract : Test for 'walk_back' to the start state: the state must */
+/*            be in its level, as kept by the shard owning it. Each   */
+/*            state of a level is reached from the start state, so    */
+/*            the walk never has to go back on a move undone.         */
+/* Returns  : 1 if accepted or 0 if not                               */
+/* In       : actual_p  pointer to state                              */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the workers have expanded beyond the level of the state */
+/* Post     : If a worker or pipe failed the program exits.           */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+shard_member(STATE *actual_p)
+{ KEY   key = state_key(actual_p);
+  char  found[SHARD_BATCH];
+
+  shard_ask(SHARD_OWNER(key), actual_p->pins, &key, 1, found);
+
+  return found[0];
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_path                                              */
+/*                                                                    */
+/* Abstract : Recover the heading and trailing part of the solution   */
+/*            by walking back to the start state from both ends of    */
+/*            the middle part; the trailing part is the reversed path */
+/*            of the reversed state.                                  */
+/* Returns  : 0 if not done or 1 if done                              */
+/* In       : head_p  pointer to the first state of the middle part   */
+/*            tail_p  pointer to the reversed last state of it        */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : the workers keep the levels above both states           */
+/* Post     : If done then the heading and trailing part of the       */
+/*            solution are stored.                                    */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+shard_path(STATE *head_p, STATE *tail_p)
+{ STATE  path[BOARD];
+  int    pins;
+
+  if (!walk_back(head_p, PINS, shard_member, path)) { return 0; }
+  for (pins = head_p->pins; pins < PINS; pins++)
+  { solution_move_state[pins] = path[pins];
+  }
+  if (!walk_back(tail_p, PINS, shard_member, path)) { return 0; }
+  for (pins = tail_p->pins; pins < PINS; pins++)
+  { path[pins].id    = ~path[pins].id;
+    path[pins].slack = ((~path[pins].slack) & 1);
+    path[pins].pins  = BOARD - pins;
+    solution_move_state[BOARD - pins] = path[pins];
+  }
+
+  return 1;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: shard_solve                                             */
+/*                                                                    */
+/* Abstract : Solve by 'shard_count' worker processes, each owning    */
+/*            the states whose key hashes to its shard. Phase 1 is    */
+/*            done breadth first: this coordinator lets the workers   */
+/*            expand one level at a time. The heading frontier stays  */
+/*            spread over the workers: for phase 2 this coordinator   */
+/*            either takes it from the workers a batch at a time and  */
+/*            does the traversal, each probe being looked up in the   */
+/*            shard owning it, or lets the workers continue the       */
+/*            expansion and join their own part of the levels (see    */
+/*            'phase2_merge'). Phase 3 is replaced by walking back    */
+/*            from both ends of the middle part (see 'shard_path').   */
+/*            No process ever holds a whole level.                    */
+/* Returns  : 0 if not done or 1 if done                              */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : If done then the solution is stored.                    */
+/*            If a worker or pipe fails, the other workers are killed */
+/*            and the program exits.                                  */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+shard_solve(void)
+{ int    inbox[SHARD_MAX][2], command[SHARD_MAX][2], report[SHARD_MAX][2];
+  int    count[SHARD_MAX];
+  int    i, k, n, total, pins, done = 0;
+  KEY    keys[SHARD_BATCH], meet = 0;
+  STATE  head, tail;
+  char   cmd;
+
+  /* a dead worker shows as a failing pipe, not as a signal */
+  shard_sigpipe = signal(SIGPIPE, SIG_IGN);
+  shard_hit     = SHARD_END;
+
+  for (i = 0; i < shard_count; i++)
+  { if (pipe(inbox[i]) != 0 || pipe(command[i]) != 0 || pipe(report[i]) != 0)
+    { printf("Cannot create pipes for %d shards.\n", shard_count);
+      exit(1);
+    }
+    fcntl(inbox[i][0], F_SETFL, fcntl(inbox[i][0], F_GETFL) | O_NONBLOCK);
+    fcntl(inbox[i][1], F_SETFL, fcntl(inbox[i][1], F_GETFL) | O_NONBLOCK);
+  }
+
+  fflush(stdout);
+  for (i = 0; i < shard_count; i++)
+  { if ((shard_pid[i] = fork()) == 0)
+    { for (k = 0; k < shard_count; k++)
+      { if (k != i)
+        { close(inbox[k][0]);
+          close(command[k][0]);
+          close(report[k][1]);
+        }
+        close(command[k][1]);
+        close(report[k][0]);
+        shard_outbox[k] = inbox[k][1];
+      }
+      close(inbox[i][1]);
+      shard_inbox   = inbox[i][0];
+      shard_command = command[i][0];
+      shard_report  = report[i][1];
+      shard_worker(i, PINS);
+    }
+    if (shard_pid[i] < 0)
+    { printf("Cannot start shard %d.\n", i);
+      exit(1);
+    }
+  }
+  for (i = 0; i < shard_count; i++)
+  { close(inbox[i][0]);
+    close(inbox[i][1]);
+    close(command[i][0]);
+    close(report[i][1]);
+    shard_to[i]   = command[i][1];
+    shard_from[i] = report[i][0];
+  }
+
+  /* expand level by level until the heading frontier is reached */
+  for (pins = PINS, total = 1; pins > PINS_LEFT && total > 0; pins--)
+  { shard_broadcast('E', count, &total);
+    printf("level %2d: %9d states\n", pins - 1, total);
+  }
+  if (total == 0)
+  { shard_stop(0);
+    return 0;
+  }
+
+  if (join_mode == JOIN_MERGE)
+  { printf("Phase 2: sharded expansion from %d to %d, join of level %d "
+      "with reversed level %d.\n",
+      PINS_LEFT, BOARD - LEVEL_MEET, LEVEL_MEET, BOARD - LEVEL_MEET);
+    for ( ; pins > BOARD - LEVEL_MEET && total > 0; pins--)
+    { shard_broadcast('E', count, &total);
+      printf("level %2d: %9d states\n", pins - 1, total);
+    }
+    printf("searching..."); fflush(stdout);
+    shard_broadcast('J', count, &total);
+    printf(" %d states at depth %d on a path,", total, LEVEL_MEET);
+    for (i = 0; i < shard_count && count[i] == 0; i++) { ; }
+    if (i < shard_count)
+    { cmd = 'F';
+      if (shard_io(shard_to[i], &cmd, 1, 1) != 0 ||
+        shard_io(shard_from[i], &meet, sizeof(meet), 0) != 0)
+      { shard_stop(1);
+      }
+      printf(" found.\n");
+      key_state(meet, LEVEL_MEET, &head);
+      tail.id    = ~head.id;
+      tail.slack = ((~head.slack) & 1);
+      tail.pins  = BOARD - LEVEL_MEET;
+      done       = 1;
+    }
+    else
+    { printf(" none usable.\n");
+    }
+  }
+  else
+  { printf("Phase 2: sharded traversal from %d to %d (%s order).\n",
+      PINS_LEFT, BOARD - PINS_LEFT, order_name[order_mode]);
+    printf("searching..."); fflush(stdout);
+    initialize_order();
+    for (i = 0; i < shard_count && shard_hit == SHARD_END; i++)
+    { /* the heading frontier of shard i, a batch at a time */
+      for (n = 1; n > 0 && shard_hit == SHARD_END; )
+      { cmd = 'N';
+        if (shard_io(shard_to[i], &cmd, 1, 1) != 0 ||
+          shard_io(shard_from[i], &n, sizeof(n), 0) != 0 ||
+          (n > 0 && shard_io(shard_from[i], keys, n * sizeof(KEY), 0) != 0))
+        { shard_stop(1);
+        }
+        for (k = 0; k < n && shard_hit == SHARD_END; k++)
+        { shard_start = keys[k];
+          key_state(keys[k], PINS_LEFT, &rotated_start);
+          solve(&rotated_start, 2);
+        }
+      }
+    }
+    for (i = 0; i < shard_count && shard_hit == SHARD_END; i++)
+    { if (shard_out_size[i] > 0) { shard_lookup(i); }
+    }
+    if (shard_hit != SHARD_END)
+    { /* redo the traversal from the frontier state having the hit */
+      shard_replay = 1;
+      key_state(shard_hit_start, PINS_LEFT, &rotated_start);
+      done = solve(&rotated_start, 2);
+    }
+    if (!done)
+    { printf(" not found.\n");
+    }
+    printf("%lld nodes visited, %lld frontier states probed.\n",
+      order_nodes, order_probes);
+    head = rotated_start;
+    tail = real_final;
+  }
+  if (done)
+  { /* the workers keep the levels to walk through */
+    printf("Phase 3: walk back from both ends to %d.\n", PINS);
+    done = shard_path(&head, &tail);
+  }
+  shard_stop(0);
+
+  return done;
+}
+
+#endif
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: reach_init                                              */
+/*                                                                    */
+/* Abstract : Determine all states on a path from the start state to  */
+/*            the final state. The levels are expanded from the start */
+/*            state down to BOARD - LEVEL_MEET. As the reversed final */
+/*            state is the start state, a state can reach the final   */
+/*            state if its reversed state can be reached from the     */
+/*            start state: this gives the states on a path at depth   */
+/*            LEVEL_MEET. Going up, a state is on a path if one of    */
+/*            its following states is. A state below LEVEL_MEET is on */
+/*            a path if its reversed state is, so these levels are    */
+/*            never expanded.                                         */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : reach[LEVEL_MEET..PINS] hold the states on a path.      */
+/*            If no memory is available the program exits.            */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+reach_init(void)
+{ KEY  succ[MOVES];
+  KEY  *reversed;
+  int  pins, i, j, n, n_succ, max = 0;
+
+  key_append(&level[PINS], &level_size[PINS], &max, state_key(&start_state));
+  for (pins = PINS; pins > BOARD - LEVEL_MEET; pins--)
+  { level_expand(pins);
+  }
+
+  /* meet the reversed level BOARD - LEVEL_MEET, in place */
+  n        = level_size[BOARD - LEVEL_MEET];
+  reversed = level[BOARD - LEVEL_MEET];
+  for (i = 0; i < n; i++)
+  { reversed[i] = key_reverse(reversed[i]);
+  }
+  n = key_sort(reversed, n);
+  reach[LEVEL_MEET] = (KEY*)mem_realloc(NULL, n * sizeof(KEY));
+  reach_size[LEVEL_MEET] = key_intersect(level[LEVEL_MEET],
+    level_size[LEVEL_MEET], reversed, n, reach[LEVEL_MEET]);
+  printf("level %2d: %9d states, %9d on a path\n",
+    LEVEL_MEET, level_size[LEVEL_MEET], reach_size[LEVEL_MEET]);
+  for (pins = BOARD - LEVEL_MEET; pins <= LEVEL_MEET; pins++)
+  { free(level[pins]);
+    level[pins]      = NULL;
+    level_size[pins] = 0;
+  }
+
+  for (pins = LEVEL_MEET + 1; pins <= PINS; pins++)
+  { /* keep the states having a following state on a path, in place */
+    for (i = n = 0; i < level_size[pins]; i++)
+    { n_succ = key_successors(level[pins][i], pins, succ);
+      for (j = 0; j < n_succ; j++)
+      { if (bsearch(&succ[j], reach[pins - 1], reach_size[pins - 1],
+          sizeof(KEY), key_compare) != NULL)
+        { level[pins][n++] = level[pins][i];
+          break;
+        }
+      }
+    }
+    printf("level %2d: %9d states, %9d on a path\n",
+      pins, level_size[pins], n);
+    reach[pins]      = level[pins];
+    reach_size[pins] = n;
+    level[pins]      = NULL;
+    level_size[pins] = 0;
+  }
+  level_free();
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: reach_check                                             */
+/*                                                                    */
+/* Abstract : Determine if the final state can still be reached.      */
+/* Returns  : 1 if the final state can be reached or 0 if not         */
+/* In       : actual_p  pointer to state being checked                */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : 'reach_init' is done, actual_p is reached from the      */
+/*            start state                                             */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+reach_check(STATE *actual_p)
+{ KEY  key  = state_key(actual_p);
+  int  pins = actual_p->pins;
+
+  if (pins < LEVEL_MEET)
+  { key  = key_reverse(key);
+    pins = BOARD - pins;
+  }
+
+  return bsearch(&key, reach[pins], reach_size[pins], sizeof(KEY),
+    key_compare) != NULL;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: solution_symmetric                                      */
+/*                                                                    */
+/* Abstract : Determine if a state is the one to be taken out of its  */
+/*            images under the symmetries leaving the path so far     */
+/*            unchanged: the image with the maximal id. Taking only   */
+/*            these states yields each solution once, not in all its  */
+/*            rotations and mirrorings; e.g. after d2-d4 the board is */
+/*            still symmetric in column d, so the first move breaking */
+/*            this symmetry decides which of both is taken.           */
+/* Returns  : symmetries (bit 4 * mirror + #of rotations) leaving the */
+/*            state unchanged, or 0 if the state is not taken         */
+/* In       : new_p  state being checked                              */
+/*            sym    symmetries leaving the path so far unchanged     */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : bit 0 (no symmetry) is set in 'sym'                     */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+solution_symmetric(STATE *new_p, int sym)
+{ STATE  mirror, image;
+  int    i;
+
+  mirror_state(new_p, &mirror);
+  for (i = 1; i < SYMMETRIES; i++)
+  { if (sym & (1 << i))
+    { rotate_state((i < 4) ? new_p : &mirror, &image, i % 4);
+      if (image.id > new_p->id) { return 0; }
+      if (image.id < new_p->id) { sym &= ~(1 << i); }
+    }
+  }
+
+  return sym;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: solution_first                                          */
+/*                                                                    */
+/* Abstract : Initialize an iterator over all solutions.              */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : it  iterator positioned before the first solution       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+solution_first(SOLUTION_ITER *it)
+{
+  it->pins        = PINS;
+  it->state[PINS] = start_state;
+  it->next[PINS]  = 0;
+  it->sym[PINS]   = (1 << SYMMETRIES) - 1;
+
+  return;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: solution_next                                           */
+/*                                                                    */
+/* Abstract : Continue a depth first traversal, kept in the iterator, */
+/*            up to the next solution. Only moves to states on a path */
+/*            to the final state are done (see 'reach_check'), so no  */
+/*            time is lost in dead ends, and of symmetric moves only  */
+/*            one is done (see 'solution_symmetric').                 */
+/* Returns  : 1 if a solution is found or 0 if all are done           */
+/* In       : -                                                       */
+/* In/Out   : it  iterator; on a solution it->state[PINS..1] are the  */
+/*                states and it->move[PINS..2] the moves of it        */
+/* Out      : -                                                       */
+/* Pre      : 'reach_init' and 'solution_first' are done              */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+solution_next(SOLUTION_ITER *it)
+{ STATE  *actual_p, new_state;
+  int    cand[MOVES];
+  int    j, k, n, sym = 0;
+
+  if (it->pins == 1)
+  { /* resume after the previous solution */
+    it->pins++;
+  }
+  while (it->pins <= PINS)
+  { actual_p = &it->state[it->pins];
+    n = state_moves(actual_p, 0, cand);
+    for (j = MOVES, k = 0; k < n && j == MOVES; k++)
+    { if (cand[k] < it->next[it->pins]) { continue; }
+      apply_move(actual_p, cand[k], &new_state);
+      if ((sym = solution_symmetric(&new_state, it->sym[it->pins])) != 0 &&
+        reach_check(&new_state))
+      { j = cand[k];
+      }
+    }
+    if (j == MOVES)
+    { /* all moves done, backtrack */
+      it->pins++;
+      continue;
+    }
+    it->next[it->pins]  = j + 1;
+    it->move[it->pins]  = j;
+    it->pins--;
+    it->state[it->pins] = new_state;
+    it->next[it->pins]  = 0;
+    it->sym[it->pins]   = sym;
+    if (it->pins == 1)
+    { return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: show_moves                                              */
+/*                                                                    */
+/* Abstract : Display the moves of a solution on one line, each move  */
+/*            as the column (a..g) and row (1..7) of the pin jumping  */
+/*            and of the pinhole jumped to.                           */
+/* Returns  : -                                                       */
+/* In       : it  iterator holding a solution                         */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : 'solution_next' returned 1                              */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+show_moves(SOLUTION_ITER *it)
+{ const UPDATE  *update_p;
+        int     pins;
+
+  for (pins = PINS; pins > 1; pins--)
+  { update_p = &table[it->move[pins]];
+    printf(" %c%d-%c%d",
+      'a' + hole_col[update_p->nxt2], 1 + hole_row[update_p->nxt2],
+      'a' + hole_col[update_p->pinh], 1 + hole_row[update_p->pinh]);
+  }
+  printf("\n");
+
+  return;
+}
+
+#ifdef CHECK_TABLE
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: check_table                                             */
+/*                                                                    */
+/* Abstract : Check the move table, the unrolled move loops and the   */
+/*            pinhole positions against the board layout, in which    */
+/*            the pinhole numbers are placed on an 11x11 grid with a  */
+/*            border of 2 (-1 outside the board). The moves to each   */
+/*            pinhole are derived in the direction order up, right,   */
+/*            down, left, as listed in 'PINHOLE_MOVES'.               */
+/* Returns  : -                                                       */
+/* In       : -                                                       */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : If the table does not match the program exits.          */
+/*            Only in a build with CHECK_TABLE defined.               */
+/*                                                                    */
+/**********************************************************************/
+
+static void
+check_table(void)
+{ static const int  arr[121] =
+  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1,  0,  1,  2, -1, -1, -1, -1,
+    -1, -1, -1, -1,  3,  4,  5, -1, -1, -1, -1,
+    -1, -1, 26, 29,  6,  7, 14, 11,  8, -1, -1,
+    -1, -1, 25, 28, 31, SL, 15, 12,  9, -1, -1,
+    -1, -1, 24, 27, 30, 23, 22, 13, 10, -1, -1,
+    -1, -1, -1, -1, 21, 20, 19, -1, -1, -1, -1,
+    -1, -1, -1, -1, 18, 17, 16, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+  };
+  static const int  step[4] = { -11, 1, 11, -1 };
+         STATE      actual;
+         int        cand[4];
+         int        i, d, k, n, pin, next, nxt2, j = 0, ok = 1;
+
+  for (pin = 0; pin < BOARD; pin++)
+  { for (i = 0; arr[i] != pin; i++) { ; }
+    ok &= hole_row[pin] == i / 11 - 2 && hole_col[pin] == i % 11 - 2 &&
+      hole_mirror[pin] == arr[i - i % 11 + 10 - i % 11];
+
+    /* all other pinholes filled: every move to 'pin' is possible */
+    actual.id    = ~BIT_ID(pin);
+    actual.slack = BIT_SL(pin) ^ 1;
+    actual.pins  = PINS;
+    n = pin_moves(&actual, pin, cand);
+    for (d = k = 0; d < 4; d++)
+    { next = arr[i + step[d]];
+      nxt2 = arr[i + 2 * step[d]];
+      if (next != -1 && nxt2 != -1)
+      { ok &= j < MOVES && k < n && cand[k] == j &&
+          table[j].pinh == pin && table[j].next == next &&
+          table[j].nxt2 == nxt2 &&
+          table[j].mask_id == (BIT_ID(pin) | BIT_ID(next) | BIT_ID(nxt2));
+        j++;
+        k++;
+      }
+    }
+    ok &= k == n;
+  }
+  if (!ok || j != MOVES)
+  { printf("Move table does not match the board layout.\n");
+    exit(1);
+  }
+
+  return;
+}
+
+#endif
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: memory_cap                                              */
+/*                                                                    */
+/* Abstract : Divide a memory cap over the frontier table (at most    */
+/*            half of it) and the cache (the rest, at most HASH_SIZ   */
+/*            entries).                                               */
+/* Returns  : 1 if the whole hash table fits, so the exact mode keeps */
+/*            to the cap, or 0 if not                                 */
+/* In       : megabytes  memory cap                                   */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : frontier_max and cache_entries are set.                 */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+memory_cap(int megabytes)
+{ double  entries = (double)megabytes * 1024 * 1024 / sizeof(STATE);
+
+  for (frontier_max = 1024; 4.0 * frontier_max <= entries; frontier_max *= 2)
+  { ;
+  }
+  if (entries - frontier_max < HASH_SIZ)
+  { cache_entries = (int)(entries - frontier_max) / CACHE_WAYS * CACHE_WAYS;
+    return 0;
+  }
+  cache_entries = HASH_SIZ / CACHE_WAYS * CACHE_WAYS;
+
+  return 1;
+}
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: option_index                                            */
+/*                                                                    */
+/* Abstract : Look up a command line option value in a list of names. */
+/* Returns  : index of the name or -1 if not found                    */
+/* In       : arg    option value                                     */
+/*            names  list of allowed names                            */
+/*            count  #of names                                        */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+static int
+option_index(const char *arg, const char *names[], int count)
+{ int  i;
+
+  for (i = 0; i < count; i++)
+  { if (strcmp(arg, names[i]) == 0) { return i; }
+  }
+
+  return -1;
+}
+
+/******************************/
+/*  Global operations         */
+/******************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* Operation: main                                                    */
+/*                                                                    */
+/* Abstract : Solve the solitaire problem.                            */
+/*            The solotion process is split up in three phases:       */
+/*            Phase 1 sets up a hash table in which all possible      */
+/*                    states are stored at depth PINS_LEFT. With '-c' */
+/*                    the table is a lossy cache, and '-m' caps its   */
+/*                    memory and that of the table of the states at   */
+/*                    depth PINS_LEFT; if phase 2 then finds no path, */
+/*                    phases 1 and 2 are retried on parts of these    */
+/*                    states (see 'frontier_retry').                  */
+/*                    With '-s' this is done by worker processes      */
+/*                    holding the states between them, and phase 3 is */
+/*                    replaced by a walk back (see 'shard_solve').    */
+/*                    Note that the states at depth BOARD - PINS_LEFT */
+/*                    are the same states, but reversed.              */
+/*            Phase 2 finds a path between depth PINS_LEFT (the       */
+/*                    heading frontier) and BOARD - PINS_LEFT (the    */
+/*                    trailing frontier). The clue is to match a      */
+/*                    reversed state of the depth first traversal     */
+/*                    with a state of the trailing frontier.          */
+/*                    This is done using the hash table ('-j probe',  */
+/*                    default) or by a join of sorted levels further  */
+/*                    down ('-j merge', see 'phase2_merge').          */
+/*                    The order in which moves are tried during the   */
+/*                    traversal is selected with '-o'.                */
+/*            Phase 3 again creates the hash table but keeps in mind  */
+/*                    that the two states indicating the head and     */
+/*                    (reversed) tail (of the path found in Phase 2)  */
+/*                    must be found for their parts of the solution.  */
+/*            Finally the solution is obtained when the result of     */
+/*            phase 2 is combined with the result of phase 3.         */
+/*            With '-n' none of the phases is done: the solutions are */
+/*            listed from the states on a path (see 'reach_init' and  */
+/*            'solution_next').                                       */
+/* Returns  : 0, or 1 if the arguments are wrong or no solution is    */
+/*            found                                                   */
+/* In       : argc, argv  command line arguments                      */
+/* In/Out   : -                                                       */
+/* Out      : -                                                       */
+/* Pre      : -                                                       */
+/* Post     : -                                                       */
+/*                                                                    */
+/**********************************************************************/
+
+int
+main(int argc, char *argv[])
+{ int            i, idx, done;
+  int            megabytes = 0, ordered = 0, cached = 0, joined = 0;
+  long           n;
+  clock_t        ticks;
+  SOLUTION_ITER  it;
+
+#ifdef CHECK_TABLE
+  check_table();
+#endif
+
+  for (i = 1; i < argc; i++)
+  { if (strcmp(argv[i], "-j") == 0 && i + 1 < argc &&
+      (idx = option_index(argv[i + 1], join_name, 2)) != -1)
+    { join_mode = idx;
+      joined    = 1;
+      i++;
+      continue;
+    }
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc &&
+      (idx = option_index(argv[i + 1], order_name, ORDER_COUNT)) != -1)
+    { order_mode = idx;
+      ordered    = 1;
+      i++;
+      continue;
+    }
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc &&
+      (idx = atoi(argv[i + 1])) >= 1 && idx <= SHARD_MAX)
+    { shard_count = idx;
+      i++;
+      continue;
+    }
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc &&
+      (n = atol(argv[i + 1])) >= 1)
+    { solution_count = n;
+      i++;
+      continue;
+    }
+    if (strcmp(argv[i], "-c") == 0 && i + 1 < argc &&
+      (idx = option_index(argv[i + 1], cache_name, CACHE_COUNT)) != -1)
+    { cache_option = idx;
+      cached       = 1;
+      i++;
+      continue;
+    }
+    if (strcmp(argv[i], "-m") == 0 && i + 1 < argc &&
+      (idx = atoi(argv[i + 1])) >= 1)
+    { megabytes = idx;
+      i++;
+      continue;
+    }
+    printf("usage: %s [-j probe|merge] "
+      "[-o bits|center|isolated|history|pagoda] [-s 1..%d] [-n count]\n"
+      "       [-c exact|depth|always|two-tier] [-m megabytes]\n",
+      argv[0], SHARD_MAX);
+    return 1;
+  }
+  if (join_mode == JOIN_MERGE && ordered)
+  { /* the sorted join does no traversal */
+    printf("Option -o can not be used with -j merge.\n");
+    return 1;
+  }
+
+  if (solution_count > 0 &&
+    (joined || ordered || shard_count > 0 || cached || megabytes > 0))
+  { /* the solutions are listed from the states on a path only */
+    printf("Options -j, -o, -s, -c and -m can not be used with -n.\n");
+    return 1;
+  }
+  if (megabytes > 0 && (join_mode == JOIN_MERGE || shard_count > 0))
+  { /* only the tables of phases 1 and 3 are capped */
+    printf("Option -m can not be used with -j merge or -s.\n");
+    return 1;
+  }
+  if (cached && shard_count > 0)
+  { /* the workers keep levels, not a hash table */
+    printf("Option -c can not be used with -s.\n");
+    return 1;
+  }
+
+  if (megabytes > 0 && !memory_cap(megabytes) && cache_option == CACHE_EXACT)
+  { /* the hash table does not fit, a memory cap implies cache mode */
+    if (cached)
+    { for (i = megabytes; !memory_cap(i); i++)
+      { ;
+      }
+      printf("Option -c exact needs -m %d or more.\n", i);
+      return 1;
+    }
+    cache_option = CACHE_TWO_TIER;
+  }
+
+  if (solution_count > 0)
+  { printf("Determine all states on a path from %d to 1.\n", PINS);
+    reach_init();
+    printf("Solutions (no rotations or mirror images):\n");
+    ticks = clock();
+    solution_first(&it);
+    for (n = 0; n < solution_count && solution_next(&it); n++)
+    { printf("%6ld:", n + 1);
+      show_moves(&it);
+    }
+    printf("%ld solutions in %.2f seconds.\n",
+      n, (double)(clock() - ticks) / CLOCKS_PER_SEC);
+    return 0;
+  }
+
+  if (shard_count > 0)
+  {
+#ifdef SHARDS
+    printf("Phase 1: sharded search from %d to %d (%d shards).\n",
+      PINS, PINS_LEFT, shard_count);
+    if (!shard_solve())
+    { printf("No meeting point found, no solution.\n");
+      return 1;
+    }
+    show_solution();
+    return 0;
+#else
+    printf("Sharded search is not supported on this platform.\n");
+    return 1;
+#endif
+  }
+
+  do
+  { printf("Phase 1: full search from %d to %d.\n", PINS, PINS_LEFT);
+    hash_init(cache_option);
+    solve(&start_state, 1);
+    cache_statistics();
+
+    if (join_mode == JOIN_MERGE)
+    { done = phase2_merge();
+    }
+    else
+    { done = phase2_probe();
     }
+  } while (!done && frontier_retry());
+  if (!done)
+  { printf("No meeting point found, no solution.\n");
+    return 1;
   }
 
   printf("Phase 3: locate heading and trailing parts.\n");
-  hash_init();
+  hash_init(cache_option);
   solve(&start_state, 3);
+  cache_statistics();
 
   show_solution();
 